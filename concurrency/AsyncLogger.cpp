@@ -0,0 +1,92 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "async_logger.h"
+
+// 异步日志代替std::cout
+// chapter4_1.cpp的print_thread_id、chapter5_1.cpp的do_print_id这类代码中，
+// 每个线程都锁住同一个流并用std::endl逐行刷新。
+// 这里比较两种写法在多个线程同时写日志时，每写一行日志调用方要花多少时间。
+
+static const int kThreadCount = 4;
+static const int kLinesPerThread = 20000;
+static const int kWorkPerLine = 2000;// 两行日志之间的计算量
+
+AsyncLogger gLogger;
+
+void print_thread_id(int id) {
+    gLogger.Log("thread %d (%zu)", id, std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+// 和print_thread_id的用法一样，日志由后台线程输出
+void test1() {
+    std::thread threads[10];
+    for(int i = 0; i < 10; ++i) {
+        threads[i] = std::thread(print_thread_id, i + 1);
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+}
+
+// 每个线程做一些计算、写一行日志，只统计写日志本身花的时间。
+// 线程数多于CPU核数时，个别调用会碰上线程切换，因此报告中位数和99分位
+template<typename Writer>
+void run(const char* name, Writer writer) {
+    std::vector<std::thread> threads;
+    std::vector<std::vector<double>> log_ns(kThreadCount, std::vector<double>(kLinesPerThread));
+    for(int t = 0; t < kThreadCount; ++t) {
+        threads.emplace_back([t, &writer, &log_ns] {
+            volatile unsigned work = 0;
+            for(int i = 0; i < kLinesPerThread; ++i) {
+                for(int k = 0; k < kWorkPerLine; ++k) {
+                    work = work * 31 + k;
+                }
+                auto start = std::chrono::steady_clock::now();
+                writer(t, i);
+                log_ns[t][i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            }
+        });
+    }
+    std::vector<double> all;
+    for(int t = 0; t < kThreadCount; ++t) {
+        threads[t].join();
+        all.insert(all.end(), log_ns[t].begin(), log_ns[t].end());
+    }
+    std::sort(all.begin(), all.end());
+    std::cout << name << ": p50 " << all[all.size() / 2] << " ns/line, p99 "
+              << all[all.size() * 99 / 100] << " ns/line" << std::endl;
+}
+
+// 输出到/dev/null，只比较写日志的开销
+void test2() {
+    std::ofstream stream("/dev/null");
+    std::mutex stream_mtx;
+    run("locked stream + std::endl", [&](int t, int i) {
+        std::lock_guard<std::mutex> lock(stream_mtx);
+        stream << "thread " << t << " line " << i << std::endl;
+    });
+
+    int fd = open("/dev/null", O_WRONLY);
+    {
+        AsyncLogger logger(fd, std::chrono::microseconds(100));
+        run("AsyncLogger", [&logger](int t, int i) {
+            logger.Log("thread %d line %d", t, i);
+        });
+        std::cout << "AsyncLogger dropped " << logger.DroppedCount() << " lines (buffer full)" << std::endl;
+    }
+    close(fd);
+}
+
+int main() {
+    test1();
+    // 等后台线程输出test1的日志，避免和下面std::cout的输出交错
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    test2();
+}
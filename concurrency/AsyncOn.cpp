@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "async.h"
+#include "thread_pool.h"
+
+/*
+async_on(async.h)的演示
+
+1. chapter6_2.cpp的countdown，改为在线程池上运行。
+2. DeferredExecutor：任务在get()的线程中执行，从未等待的任务不执行。
+3. 一次性发出大量很小的任务再逐个取结果，比较std::async(std::launch::async)(每个任务一个新线程)、
+   async_on(线程池)、async_on(InlineExecutor)和async_on(DeferredExecutor)。
+
+用法：AsyncOn [任务数]
+*/
+using Clock = std::chrono::steady_clock;
+
+int countdown(int from, int to) {
+    for(int i = from; i != to; --i) {
+        std::cout << i << '\n';
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    std::cout << "Finished!\n";
+    return from - to;
+}
+
+long long TinyTask(int x) {
+    long long sum = 0;
+    for(int i = 0; i < 100; ++i) {
+        sum += x ^ i;
+    }
+    return sum;
+}
+
+long long Expected(int n) {
+    long long sum = 0;
+    for(int x = 0; x < n; ++x) {
+        sum += TinyTask(x);
+    }
+    return sum;
+}
+
+template<typename Launch>
+void Measure(const char* name, int n, Launch launch) {
+    auto start = Clock::now();
+    long long sum = 0;
+    try {
+        auto futures = launch(n);
+        for(auto& fut : futures) {
+            sum += fut.get();
+        }
+    } catch(const std::system_error& e) {
+        std::cout << name << ": failed after " << std::chrono::duration<double>(Clock::now() - start).count()
+                  << "s: " << e.what() << std::endl;
+        return;
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::cout << name << ": " << static_cast<long long>(n / elapsed.count()) << " tasks/s"
+              << (sum == Expected(n) ? "" : " (wrong sum)") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 10000;
+    if(n <= 0) {
+        std::cerr << "usage: AsyncOn [tasks]" << std::endl;
+        return 1;
+    }
+    ThreadPool pool(4);
+
+    LightFuture<int> ret = async_on(pool, countdown, 5, 0);
+    int value = ret.get();
+    std::cout << "The countdown lasted for " << value << " ticks.\n";
+
+    LightFuture<std::thread::id> lazy = async_on(DeferredExecutor{}, [] { return std::this_thread::get_id(); });
+    bool same_thread = lazy.get() == std::this_thread::get_id();
+    std::cout << "deferred task ran on the " << (same_thread ? "waiting" : "another") << " thread\n";
+    {
+        LightFuture<int> never = async_on(DeferredExecutor{}, [] {
+            std::cout << "this line is never printed\n";
+            return 0;
+        });
+    }
+
+    Measure("std::async(launch::async)", n, [](int n) {
+        std::vector<std::future<long long>> futures;
+        for(int x = 0; x < n; ++x) {
+            futures.push_back(std::async(std::launch::async, TinyTask, x));
+        }
+        return futures;
+    });
+    Measure("async_on(pool)", n, [&pool](int n) {
+        std::vector<LightFuture<long long>> futures;
+        for(int x = 0; x < n; ++x) {
+            futures.push_back(async_on(pool, TinyTask, x));
+        }
+        return futures;
+    });
+    Measure("async_on(inline)", n, [](int n) {
+        std::vector<LightFuture<long long>> futures;
+        for(int x = 0; x < n; ++x) {
+            futures.push_back(async_on(InlineExecutor{}, TinyTask, x));
+        }
+        return futures;
+    });
+    Measure("async_on(deferred)", n, [](int n) {
+        std::vector<LightFuture<long long>> futures;
+        for(int x = 0; x < n; ++x) {
+            futures.push_back(async_on(DeferredExecutor{}, TinyTask, x));
+        }
+        return futures;
+    });
+}
@@ -0,0 +1,131 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "barrier.h"
+
+/*
+Latch和屏障(barrier.h)的演示
+
+1. 用Latch代替chapter5_1.cpp中go()的condition_variable作为发令枪，放行10个线程。
+2. 迭代式的并行计算：每一轮每个线程写自己的槽位，过屏障后检查所有线程都写完了这一轮，
+   反复同步很多轮，比较condition_variable实现的屏障、CentralBarrier和DisseminationBarrier
+   在不同等待策略下每秒能完成的同步次数。检查失败的次数应当始终为0。
+
+用法：Barrier [线程数] [轮数]
+*/
+using Clock = std::chrono::steady_clock;
+
+// 作为对照：用互斥量和条件变量实现的屏障
+class CondVarBarrier {
+public:
+    explicit CondVarBarrier(int participants) : participants(participants), remaining(participants) {}
+
+    void arrive_and_wait() {
+        std::unique_lock<std::mutex> lck(mtx);
+        unsigned current = generation;
+        if(--remaining == 0) {
+            remaining = participants;
+            ++generation;
+            cv.notify_all();
+            return;
+        }
+        cv.wait(lck, [this, current] { return generation != current; });
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    const int participants;
+    int remaining;
+    unsigned generation = 0;
+};
+
+// 集中式的屏障不需要线程编号，包装成和DisseminationBarrier相同的接口
+template<typename Barrier>
+struct IgnoreId {
+    explicit IgnoreId(int participants) : barrier(participants) {}
+    void arrive_and_wait(int) {
+        barrier.arrive_and_wait();
+    }
+    Barrier barrier;
+};
+
+void StartGate() {
+    Latch<> start(1);
+    Latch<> done(10);
+    std::atomic<int> order(0);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 10; ++i) {
+        threads.emplace_back([&, i] {
+            start.wait();
+            order.fetch_add(1);
+            done.count_down();
+        });
+    }
+    std::cout << "10 threads ready to race...\n";
+    start.count_down(); // go!
+    done.wait();
+    std::cout << order.load() << " threads finished\n";
+    for(auto& th : threads) {
+        th.join();
+    }
+}
+
+template<typename Barrier>
+void RunPhases(const std::string& name, int thread_count, int rounds) {
+    Barrier barrier(thread_count);
+    // 两组槽位交替使用：第p轮写slots[p&1]，下一次写同一组是在第p+2轮，那时所有线程都已读完第p轮
+    std::vector<int> slots[2] = {std::vector<int>(thread_count, -1), std::vector<int>(thread_count, -1)};
+    std::atomic<long long> mismatches(0);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for(int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            long long bad = 0;
+            for(int p = 0; p < rounds; ++p) {
+                std::vector<int>& slot = slots[p & 1];
+                slot[t] = p;
+                barrier.arrive_and_wait(t);
+                for(int v : slot) {
+                    if(v != p) {
+                        ++bad;
+                    }
+                }
+            }
+            mismatches += bad;
+        });
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::cout << name << ": " << rounds << " rounds in " << elapsed.count() << "s, "
+              << static_cast<long long>(rounds / elapsed.count()) << " barriers/s, "
+              << mismatches << " mismatches" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int thread_count = argc > 1 ? std::atoi(argv[1]) : 4;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 20000;
+    if(thread_count <= 0 || rounds <= 0) {
+        std::cerr << "usage: Barrier [threads] [rounds]" << std::endl;
+        return 1;
+    }
+
+    StartGate();
+
+    std::cout << thread_count << " threads" << std::endl;
+    RunPhases<IgnoreId<CondVarBarrier>>("condition_variable", thread_count, rounds);
+    RunPhases<IgnoreId<CentralBarrier<SpinYieldWait>>>("central/spin", thread_count, rounds);
+    RunPhases<IgnoreId<CentralBarrier<SpinThenParkWait>>>("central/spin_then_park", thread_count, rounds);
+    RunPhases<IgnoreId<CentralBarrier<BlockingWait>>>("central/blocking", thread_count, rounds);
+    RunPhases<DisseminationBarrier<SpinYieldWait>>("dissemination/spin", thread_count, rounds);
+    RunPhases<DisseminationBarrier<SpinThenParkWait>>("dissemination/spin_then_park", thread_count, rounds);
+    RunPhases<DisseminationBarrier<BlockingWait>>("dissemination/blocking", thread_count, rounds);
+}
@@ -0,0 +1,139 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "batch_factorizer.h"
+#include "factorizer.h"
+#include "thread_pool.h"
+
+/*
+Factorize / FactorizeBatch(factorizer.h、batch_factorizer.h)的演示
+
+1. 小范围内和逐个试除的结果对比；IsPrime64对强伪素数、Carmichael数以及64位边界的判断。
+2. 难分解的数：两个接近2^32的素数之积、大素数的平方、三个21位素数之积。
+3. 随机64位数：检查因子之积等于原数、每个因子都是素数且有序。
+4. 吞吐量：单线程逐个分解与FactorizeBatch在线程池上批量分解，结果应当相同。
+
+用法：Factorizer [批量的个数，默认200000] [线程数]
+*/
+using Clock = std::chrono::steady_clock;
+
+std::vector<uint64_t> FactorizeTrial(uint64_t n) {
+    std::vector<uint64_t> factors;
+    for(uint64_t p = 2; p * p <= n; ++p) {
+        while(n % p == 0) {
+            factors.push_back(p);
+            n /= p;
+        }
+    }
+    if(n > 1) {
+        factors.push_back(n);
+    }
+    return factors;
+}
+
+bool Consistent(uint64_t n, const std::vector<uint64_t>& factors) {
+    if(n < 2) {
+        return factors.empty();
+    }
+    unsigned __int128 product = 1;
+    for(std::size_t i = 0; i < factors.size(); ++i) {
+        if(!IsPrime64(factors[i]) || (i > 0 && factors[i - 1] > factors[i])) {
+            return false;
+        }
+        product *= factors[i];
+    }
+    return product == n;
+}
+
+uint64_t RandomPrime(std::mt19937_64& rng, uint64_t lo, uint64_t hi) {
+    std::uniform_int_distribution<uint64_t> dist(lo, hi);
+    for(;;) {
+        uint64_t p = dist(rng);
+        if(IsPrime64(p)) {
+            return p;
+        }
+    }
+}
+
+double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    long count = argc > 1 ? std::atol(argv[1]) : 200000;
+    int threads = argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    if(count <= 0 || threads <= 0) {
+        std::cerr << "usage: Factorizer [count] [threads]" << std::endl;
+        return 1;
+    }
+    std::mt19937_64 rng(2024);
+
+    int mismatches = 0;
+    for(uint64_t n = 0; n < 200000; ++n) {
+        mismatches += Factorize(n) != FactorizeTrial(n);
+    }
+    for(uint64_t n = (uint64_t(1) << 40) - 2000; n < (uint64_t(1) << 40); ++n) {
+        mismatches += Factorize(n) != FactorizeTrial(n);
+    }
+    struct Known {
+        uint64_t n;
+        bool prime;
+    };
+    static const Known kKnown[] = {
+        {561, false},                         // Carmichael数
+        {3215031751ull, false},               // 对底数2、3、5、7都是强伪素数
+        {3825123056546413051ull, false},      // 对2到23的所有素数底数都是强伪素数
+        {4294967291ull, true},                // 小于2^32的最大素数
+        {18446744073709551557ull, true},      // 小于2^64的最大素数
+        {18446744073709551615ull, false},     // 2^64-1
+    };
+    for(const Known& k : kKnown) {
+        mismatches += IsPrime64(k.n) != k.prime;
+    }
+    mismatches += Factorize(18446744073709551615ull) !=
+                  std::vector<uint64_t>{3, 5, 17, 257, 641, 65537, 6700417};
+    std::cout << "checked against trial division and known values: " << mismatches << " mismatches" << std::endl;
+
+    int hard_mismatches = 0;
+    auto start = Clock::now();
+    for(int i = 0; i < 200; ++i) {
+        uint64_t p = RandomPrime(rng, uint64_t(1) << 31, (uint64_t(1) << 32) - 1);
+        uint64_t q = RandomPrime(rng, uint64_t(1) << 31, (uint64_t(1) << 32) - 1);
+        std::vector<uint64_t> expected = p < q ? std::vector<uint64_t>{p, q} : std::vector<uint64_t>{q, p};
+        hard_mismatches += Factorize(p * q) != expected;
+        hard_mismatches += Factorize(p * p) != std::vector<uint64_t>{p, p};
+        uint64_t a = RandomPrime(rng, uint64_t(1) << 20, (uint64_t(1) << 21) - 1);
+        uint64_t b = RandomPrime(rng, uint64_t(1) << 20, (uint64_t(1) << 21) - 1);
+        uint64_t c = RandomPrime(rng, uint64_t(1) << 20, (uint64_t(1) << 21) - 1);
+        hard_mismatches += !Consistent(a * b * c, Factorize(a * b * c)) || Factorize(a * b * c).size() != 3;
+    }
+    std::cout << "600 hard composites: " << hard_mismatches << " mismatches in " << Seconds(start) << " s"
+              << std::endl;
+
+    std::vector<uint64_t> values(count);
+    for(uint64_t& v : values) {
+        v = rng();
+    }
+    start = Clock::now();
+    std::vector<std::vector<uint64_t>> serial(values.size());
+    for(std::size_t i = 0; i < values.size(); ++i) {
+        serial[i] = Factorize(values[i]);
+    }
+    double serial_seconds = Seconds(start);
+    int random_mismatches = 0;
+    for(std::size_t i = 0; i < values.size(); ++i) {
+        random_mismatches += !Consistent(values[i], serial[i]);
+    }
+    std::cout << count << " random 64-bit values: " << random_mismatches << " inconsistent, serial "
+              << serial_seconds << " s (" << count / serial_seconds << " values/s)" << std::endl;
+
+    ThreadPool pool(threads);
+    start = Clock::now();
+    std::vector<std::vector<uint64_t>> batch = FactorizeBatch(pool, values);
+    double batch_seconds = Seconds(start);
+    std::cout << "FactorizeBatch x" << threads << ": " << batch_seconds << " s (" << count / batch_seconds
+              << " values/s), " << (batch == serial ? "same as serial" : "DIFFERS from serial") << std::endl;
+}
@@ -0,0 +1,192 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "future_combinators.h"
+#include "light_future.h"
+#include "thread_pool.h"
+
+/*
+LightFuture的续延(then)和组合(when_all/when_any)的演示
+
+1. chapter6_3.cpp的test7用wait_for(1s)轮询一个耗时的任务，这里改为用then在任务完成时打印结果，
+   主线程不用轮询。
+2. 扇出/汇聚：每个请求向后端并发发出若干子请求，全部返回后汇总。
+   - 阻塞方式：每个请求占用线程池中的一个线程，依次get()子请求的结果，
+     同时在处理的请求数不超过线程数。
+   - 续延方式：when_all(子请求).then(pool, 汇总)，等待期间不占用线程，所有请求同时在途。
+   后端每隔一个固定的延迟成批返回结果，模拟网络往返。
+3. 对冲请求(hedged request)：同一个请求发给快慢两个副本，when_any取先返回的那个。
+   落选的慢副本仍然可以用then等它返回，续延执行时它一定已经就绪。
+
+用法：FutureContinuation [请求数] [扇出数]
+*/
+using Clock = std::chrono::steady_clock;
+
+// 模拟的远程服务：请求在下一个延迟周期结束时返回x*x
+class Backend {
+public:
+    explicit Backend(std::chrono::microseconds latency) : latency(latency), worker(&Backend::Run, this) {}
+    ~Backend() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        worker.join();
+    }
+
+    LightFuture<long long> Call(long long x) {
+        LightPromise<long long> promise;
+        LightFuture<long long> result = promise.get_future();
+        std::lock_guard<std::mutex> lock(mtx);
+        pending.emplace_back(std::move(promise), x);
+        return result;
+    }
+
+private:
+    void Run() {
+        bool done = false;
+        while(!done) {
+            std::this_thread::sleep_for(latency);
+            std::vector<std::pair<LightPromise<long long>, long long>> batch;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                batch.swap(pending);
+                done = stopping;
+            }
+            for(auto& call : batch) {
+                call.first.set_value(call.second * call.second);
+            }
+        }
+    }
+
+    const std::chrono::microseconds latency;
+    std::mutex mtx;
+    std::vector<std::pair<LightPromise<long long>, long long>> pending;
+    bool stopping = false;
+    std::thread worker;
+};
+
+double ThreadTask(int n) {
+    double sum = 0;
+    for(int i = 1; i <= n; ++i) {
+        sum += std::sqrt(i);
+    }
+    return sum;
+}
+
+void Continuation(ThreadPool& pool) {
+    LightPackagedTask<double()> task([] { return ThreadTask(20000000); });
+    LightFuture<double> fut = task.get_future();
+    pool.execute(std::move(task));
+    LightFuture<void> printed = fut.then(pool, [](LightFuture<double> f) {
+        std::cout << "task finished: " << f.get() << std::endl;
+    });
+    std::cout << "main thread keeps working while the task runs..." << std::endl;
+    printed.get();
+}
+
+long long Expected(int requests, int fanout) {
+    long long sum = 0;
+    for(int r = 0; r < requests; ++r) {
+        for(int k = 0; k < fanout; ++k) {
+            long long x = r * fanout + k;
+            sum += x * x;
+        }
+    }
+    return sum;
+}
+
+void FanOutBlocking(ThreadPool& pool, Backend& backend, int requests, int fanout) {
+    auto start = Clock::now();
+    std::vector<std::future<long long>> results;
+    for(int r = 0; r < requests; ++r) {
+        results.push_back(pool.submit([&backend, r, fanout] {
+            std::vector<LightFuture<long long>> calls;
+            for(int k = 0; k < fanout; ++k) {
+                calls.push_back(backend.Call(r * fanout + k));
+            }
+            long long sum = 0;
+            for(auto& call : calls) {
+                sum += call.get(); // 阻塞工作线程
+            }
+            return sum;
+        }));
+    }
+    long long total = 0;
+    for(auto& result : results) {
+        total += result.get();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::cout << "blocking fan-out: " << elapsed.count() * 1000 << " ms"
+              << (total == Expected(requests, fanout) ? "" : " (wrong sum)") << std::endl;
+}
+
+void FanOutContinuation(ThreadPool& pool, Backend& backend, int requests, int fanout) {
+    auto start = Clock::now();
+    std::vector<LightFuture<long long>> results;
+    for(int r = 0; r < requests; ++r) {
+        std::vector<LightFuture<long long>> calls;
+        for(int k = 0; k < fanout; ++k) {
+            calls.push_back(backend.Call(r * fanout + k));
+        }
+        results.push_back(when_all(std::move(calls)).then(pool, [](LightFuture<std::vector<LightFuture<long long>>> all) {
+            long long sum = 0;
+            for(auto& call : all.get()) {
+                sum += call.get(); // 已经就绪，不会阻塞
+            }
+            return sum;
+        }));
+    }
+    long long total = 0;
+    for(auto& result : results) {
+        total += result.get();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::cout << "continuation fan-out: " << elapsed.count() * 1000 << " ms"
+              << (total == Expected(requests, fanout) ? "" : " (wrong sum)") << std::endl;
+}
+
+void Hedged(Backend& fast, Backend& slow) {
+    auto start = Clock::now();
+    std::vector<LightFuture<long long>> replicas;
+    replicas.push_back(slow.Call(7));
+    replicas.push_back(fast.Call(7));
+    WhenAnyResult<long long> first = when_any(std::move(replicas)).get();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::cout << "hedged request answered by replica " << first.index << ": "
+              << first.futures[first.index].get() << " after " << elapsed.count() * 1000 << " ms" << std::endl;
+    // 落选的副本上已经有when_any登记的回调，then登记的续延要等它真正返回才执行
+    std::size_t loser = 1 - first.index;
+    LightFuture<bool> late = first.futures[loser].then([](LightFuture<long long> f) {
+        bool ready = f.is_ready();
+        f.get();
+        return ready;
+    });
+    std::cout << "losing replica's continuation ran " << (late.get() ? "after it was ready" : "too early")
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int requests = argc > 1 ? std::atoi(argv[1]) : 200;
+    int fanout = argc > 2 ? std::atoi(argv[2]) : 8;
+    if(requests <= 0 || fanout <= 0) {
+        std::cerr << "usage: FutureContinuation [requests] [fanout]" << std::endl;
+        return 1;
+    }
+    ThreadPool pool(4);
+    Continuation(pool);
+
+    Backend backend(std::chrono::milliseconds(2));
+    std::cout << requests << " requests, fan-out " << fanout << ", " << pool.size() << " pool threads" << std::endl;
+    FanOutBlocking(pool, backend, requests, fanout);
+    FanOutContinuation(pool, backend, requests, fanout);
+
+    Backend slow(std::chrono::milliseconds(50));
+    Hedged(backend, slow);
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "hybrid_mutex.h"
+
+// 混合互斥量代替std::mutex/std::recursive_mutex
+// chapter4_1.cpp中的Counter，临界区只有一次加法，
+// 这里把互斥量类型做成模板参数，比较多个线程同时increment时的耗时，并输出HybridMutex的竞争统计。
+
+static const int kThreadCount = 4;
+static const int kIncrementsPerThread = 200000;
+
+template<typename Mutex>
+class Counter {
+public:
+    Counter() : count(0) {}
+    int add(int val) {
+        std::lock_guard<Mutex> lock(mutex);
+        count += val;
+        return count;
+    }
+    int increment() {
+        std::lock_guard<Mutex> lock(mutex);
+        return add(1);
+    }
+    Mutex mutex;
+private:
+    int count;
+};
+
+void print_stats(const MutexStats& stats) {
+    std::cout << "  acquisitions " << stats.acquisitions
+              << ", contended " << stats.contended
+              << ", parked " << stats.parked
+              << ", avg wait " << (stats.contended ? stats.wait_ns / stats.contended : 0) << " ns" << std::endl;
+}
+void print_stats(const std::recursive_mutex&) {}
+void print_stats(const HybridRecursiveMutex& mutex) {
+    print_stats(mutex.stats());
+}
+
+template<typename Mutex>
+void run(const char* name) {
+    Counter<Mutex> counter;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for(int t = 0; t < kThreadCount; ++t) {
+        threads.emplace_back([&counter] {
+            for(int i = 0; i < kIncrementsPerThread; ++i) {
+                counter.increment();
+            }
+        });
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": count = " << counter.add(0) << ", " << elapsed.count() << " ms" << std::endl;
+    print_stats(counter.mutex);
+}
+
+void test1() {
+    run<std::recursive_mutex>("std::recursive_mutex");
+    run<HybridRecursiveMutex>("HybridRecursiveMutex");
+}
+
+// HybridMutex满足Lockable，可以和std::unique_lock、std::condition_variable_any一起使用
+void test2() {
+    HybridMutex mtx;
+    std::condition_variable_any cv;
+    bool ready = false;
+    std::thread waiter([&] {
+        std::unique_lock<HybridMutex> lock(mtx);
+        cv.wait(lock, [&ready] { return ready; });
+        std::cout << "waiter woke up" << std::endl;
+    });
+    {
+        std::lock_guard<HybridMutex> lock(mtx);
+        ready = true;
+    }
+    cv.notify_one();
+    waiter.join();
+    print_stats(mtx.stats());
+}
+
+int main() {
+    test1();
+    test2();
+}
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "item_repository.h"
+#include "mpmc_item_repository.h"
+#include "sharded_item_repository.h"
+#include "spsc_item_repository.h"
+
+/*
+ItemRepository吞吐量与延迟基准测试
+
+ProducerAndComsumer1~4.cpp每个产品都sleep并打印，看不出各实现到底有多快。
+这里对每种实现(engine)用指定的生产者/消费者数、缓冲区容量和产品大小跑一遍，
+每个产品在生产时记录时间戳，消费时计算"入队到出队"的延迟，
+输出吞吐量(items/s)以及延迟的p50/p99/p99.9，每次运行输出一行JSON，方便脚本处理。
+
+用法：
+ItemRepositoryBenchmark [--engine=mutex|mutex_batch|spsc|mpmc|sharded|all]
+                        [--producers=N] [--consumers=N]
+                        [--capacity=16|64|1024|16384] [--payload=16|64|256|1024]
+                        [--items=N] [--batch=N] [--wait=spin|yield|spin_park|block]
+不带参数时跑一组默认组合。spsc只在1个生产者、1个消费者时运行。
+--wait选择spsc/mpmc/sharded的等待策略(见wait_strategy.h)，默认spin_park。
+sharded的分片数等于消费者数，--capacity是每个分片的容量。
+容量和产品大小是模板参数，只支持上面列出的取值。
+*/
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    std::string engine = "all";
+    int producers = 1;
+    int consumers = 1;
+    std::size_t capacity = 1024;
+    std::size_t payload = 16;
+    long long items = 1000000;
+    std::size_t batch = 64;
+    std::string wait = "spin_park";
+};
+
+struct BenchResult {
+    double seconds = 0;
+    std::vector<int64_t> latencies; // 纳秒
+};
+
+// 大小为Size字节的产品，开头记录入队时间
+template<std::size_t Size>
+struct Payload {
+    static_assert(Size >= sizeof(int64_t), "payload too small");
+    int64_t enqueue_ns;
+    char padding[Size - sizeof(int64_t)];
+};
+
+inline int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+}
+
+template<typename Item>
+Item MakeItem() {
+    Item item;
+    item.enqueue_ns = NowNs();
+    return item;
+}
+
+// 把总数total尽量平均地分给count个线程，返回第index个线程的份额
+inline long long ShareOf(long long total, int count, int index) {
+    return total / count + (index < total % count ? 1 : 0);
+}
+
+// 逐个生产/消费，适用于所有engine
+template<typename Repository>
+BenchResult RunOneByOne(Repository& ir, const BenchConfig& config) {
+    using Item = typename std::remove_reference<decltype(ConsumeItem(ir))>::type;
+    std::vector<std::vector<int64_t>> latencies(config.consumers);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for(int p = 0; p < config.producers; ++p) {
+        long long count = ShareOf(config.items, config.producers, p);
+        threads.emplace_back([&ir, count] {
+            for(long long i = 0; i < count; ++i) {
+                ProduceItem(ir, MakeItem<Item>());
+            }
+        });
+    }
+    for(int c = 0; c < config.consumers; ++c) {
+        long long count = ShareOf(config.items, config.consumers, c);
+        std::vector<int64_t>& lat = latencies[c];
+        lat.reserve(count);
+        threads.emplace_back([&ir, &lat, count] {
+            for(long long i = 0; i < count; ++i) {
+                Item item = ConsumeItem(ir);
+                lat.push_back(NowNs() - item.enqueue_ns);
+            }
+        });
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    BenchResult result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for(auto& lat : latencies) {
+        result.latencies.insert(result.latencies.end(), lat.begin(), lat.end());
+    }
+    return result;
+}
+
+// 批量生产/消费，只适用于互斥量版本的ItemRepository
+template<typename Item, std::size_t C>
+BenchResult RunBatched(ItemRepository<Item, C>& ir, const BenchConfig& config) {
+    std::vector<std::vector<int64_t>> latencies(config.consumers);
+    std::vector<std::thread> threads;
+    const std::size_t batch = config.batch;
+    auto start = Clock::now();
+    for(int p = 0; p < config.producers; ++p) {
+        long long count = ShareOf(config.items, config.producers, p);
+        threads.emplace_back([&ir, count, batch] {
+            std::vector<Item> items(batch);
+            for(long long i = 0; i < count; ) {
+                std::size_t n = 0;
+                for(; n < batch && i < count; ++n, ++i) {
+                    items[n] = MakeItem<Item>();
+                }
+                ProduceItems(ir, items.data(), n);
+            }
+        });
+    }
+    for(int c = 0; c < config.consumers; ++c) {
+        long long count = ShareOf(config.items, config.consumers, c);
+        std::vector<int64_t>& lat = latencies[c];
+        lat.reserve(count);
+        threads.emplace_back([&ir, &lat, count, batch] {
+            std::vector<Item> items(batch);
+            for(long long i = 0; i < count; ) {
+                std::size_t want = static_cast<std::size_t>(std::min<long long>(batch, count - i));
+                std::size_t n = ConsumeItems(ir, items.data(), want);
+                int64_t now = NowNs();
+                for(std::size_t k = 0; k < n; ++k) {
+                    lat.push_back(now - items[k].enqueue_ns);
+                }
+                i += n;
+            }
+        });
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    BenchResult result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for(auto& lat : latencies) {
+        result.latencies.insert(result.latencies.end(), lat.begin(), lat.end());
+    }
+    return result;
+}
+
+inline int64_t Percentile(const std::vector<int64_t>& sorted, double p) {
+    if(sorted.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+void Report(const std::string& engine, const BenchConfig& config, BenchResult& result) {
+    std::sort(result.latencies.begin(), result.latencies.end());
+    std::cout << "{\"engine\":\"" << engine << "\""
+              << ",\"producers\":" << config.producers
+              << ",\"consumers\":" << config.consumers
+              << ",\"wait\":\"" << (engine == "mutex" || engine == "mutex_batch" ? "condvar" : config.wait) << "\""
+              << ",\"capacity\":" << config.capacity
+              << ",\"payload\":" << config.payload
+              << ",\"items\":" << config.items
+              << ",\"seconds\":" << result.seconds
+              << ",\"items_per_sec\":" << static_cast<long long>(config.items / result.seconds)
+              << ",\"p50_ns\":" << Percentile(result.latencies, 0.5)
+              << ",\"p99_ns\":" << Percentile(result.latencies, 0.99)
+              << ",\"p999_ns\":" << Percentile(result.latencies, 0.999)
+              << "}" << std::endl;
+}
+
+template<typename Item, std::size_t Capacity, typename Wait>
+void RunLockFreeEngines(const BenchConfig& config) {
+    bool all = config.engine == "all";
+    if((all || config.engine == "spsc") && config.producers == 1 && config.consumers == 1) {
+        auto ir = std::make_unique<SpscItemRepository<Item, Capacity, Wait>>();
+        BenchResult result = RunOneByOne(*ir, config);
+        Report("spsc", config, result);
+    }
+    if(all || config.engine == "mpmc") {
+        auto ir = std::make_unique<MpmcItemRepository<Item, Capacity, Wait>>();
+        BenchResult result = RunOneByOne(*ir, config);
+        Report("mpmc", config, result);
+    }
+    if(all || config.engine == "sharded") {
+        auto ir = std::make_unique<ShardedItemRepository<Item, Capacity, Wait>>(config.consumers);
+        BenchResult result = RunOneByOne(*ir, config);
+        Report("sharded", config, result);
+    }
+}
+
+// 产品库可能很大，放在堆上
+template<typename Item, std::size_t Capacity>
+void RunEngines(const BenchConfig& config) {
+    bool all = config.engine == "all";
+    if(all || config.engine == "mutex") {
+        auto ir = std::make_unique<ItemRepository<Item, Capacity>>();
+        BenchResult result = RunOneByOne(*ir, config);
+        Report("mutex", config, result);
+    }
+    if(all || config.engine == "mutex_batch") {
+        auto ir = std::make_unique<ItemRepository<Item, Capacity>>();
+        BenchResult result = RunBatched(*ir, config);
+        Report("mutex_batch", config, result);
+    }
+    if(config.wait == "spin") {
+        RunLockFreeEngines<Item, Capacity, BusySpinWait>(config);
+    } else if(config.wait == "yield") {
+        RunLockFreeEngines<Item, Capacity, SpinYieldWait>(config);
+    } else if(config.wait == "block") {
+        RunLockFreeEngines<Item, Capacity, BlockingWait>(config);
+    } else {
+        RunLockFreeEngines<Item, Capacity, SpinThenParkWait>(config);
+    }
+}
+
+template<typename Item>
+bool DispatchCapacity(const BenchConfig& config) {
+    switch(config.capacity) {
+    case 16: RunEngines<Item, 16>(config); return true;
+    case 64: RunEngines<Item, 64>(config); return true;
+    case 1024: RunEngines<Item, 1024>(config); return true;
+    case 16384: RunEngines<Item, 16384>(config); return true;
+    default: return false;
+    }
+}
+
+bool Run(const BenchConfig& config) {
+    switch(config.payload) {
+    case 16: return DispatchCapacity<Payload<16>>(config);
+    case 64: return DispatchCapacity<Payload<64>>(config);
+    case 256: return DispatchCapacity<Payload<256>>(config);
+    case 1024: return DispatchCapacity<Payload<1024>>(config);
+    default: return false;
+    }
+}
+
+void PrintUsage(const char* prog) {
+    std::cerr << "usage: " << prog << " [--engine=mutex|mutex_batch|spsc|mpmc|sharded|all]\n"
+              << "        [--producers=N] [--consumers=N]\n"
+              << "        [--capacity=16|64|1024|16384] [--payload=16|64|256|1024]\n"
+              << "        [--items=N] [--batch=N] [--wait=spin|yield|spin_park|block]" << std::endl;
+}
+
+bool IsKnownEngine(const std::string& engine) {
+    for(const char* name : {"mutex", "mutex_batch", "spsc", "mpmc", "sharded", "all"}) {
+        if(engine == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseArg(const char* arg, BenchConfig& config) {
+    const char* eq = std::strchr(arg, '=');
+    if(std::strncmp(arg, "--", 2) != 0 || eq == nullptr) {
+        return false;
+    }
+    std::string key(arg + 2, eq);
+    const char* value = eq + 1;
+    if(key == "engine") {
+        // 拼错的engine名不能悄悄退回默认值，否则会跑出另一个engine的数字
+        if(!IsKnownEngine(value)) {
+            std::cerr << "unknown engine: " << value << std::endl;
+            return false;
+        }
+        config.engine = value;
+    } else if(key == "producers") {
+        config.producers = std::atoi(value);
+    } else if(key == "consumers") {
+        config.consumers = std::atoi(value);
+    } else if(key == "capacity") {
+        config.capacity = std::strtoull(value, nullptr, 10);
+    } else if(key == "payload") {
+        config.payload = std::strtoull(value, nullptr, 10);
+    } else if(key == "items") {
+        config.items = std::atoll(value);
+    } else if(key == "batch") {
+        config.batch = std::strtoull(value, nullptr, 10);
+    } else if(key == "wait") {
+        config.wait = value;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc == 1) {
+        // 默认组合：1对1、4对4，两种产品大小
+        BenchConfig config;
+        config.items = 200000;
+        for(int threads : {1, 4}) {
+            for(std::size_t payload : {16, 256}) {
+                config.producers = threads;
+                config.consumers = threads;
+                config.payload = payload;
+                Run(config);
+            }
+        }
+        return 0;
+    }
+    BenchConfig config;
+    for(int i = 1; i < argc; ++i) {
+        if(!ParseArg(argv[i], config)) {
+            std::cerr << "unknown argument: " << argv[i] << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if(config.producers <= 0 || config.consumers <= 0 || config.items <= 0 || config.batch == 0) {
+        std::cerr << "producers, consumers, items and batch must be positive" << std::endl;
+        return 1;
+    }
+    // 直接跳过会让脚本把"什么都没跑"当成一次成功的运行
+    if(config.engine == "spsc" && (config.producers != 1 || config.consumers != 1)) {
+        std::cerr << "engine spsc needs --producers=1 --consumers=1" << std::endl;
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if(config.wait != "spin" && config.wait != "yield" && config.wait != "spin_park" && config.wait != "block") {
+        std::cerr << "unknown wait strategy: " << config.wait << std::endl;
+        return 1;
+    }
+    if(!Run(config)) {
+        std::cerr << "unsupported capacity/payload: " << config.capacity << "/" << config.payload << std::endl;
+        return 1;
+    }
+}
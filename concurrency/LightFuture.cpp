@@ -0,0 +1,125 @@
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "light_future.h"
+
+/*
+LightPromise/LightFuture(light_future.h)的演示
+
+1. 和chapter6_1.cpp的test1一样，把future交给另一个线程，主线程稍后设置值。
+2. 异常的传递，以及promise在设置结果之前析构时的broken_promise。
+3. 和std::promise/std::future比较：
+   - 同一个线程里创建、设置、取值，衡量共享状态本身的开销。
+   - 一个线程依次设置一批promise，另一个线程依次get()，衡量跨线程传递结果的开销。
+
+用法：LightFuture [次数]
+*/
+using Clock = std::chrono::steady_clock;
+
+void Handoff() {
+    LightPromise<int> prom;
+    LightFuture<int> fut = prom.get_future();
+    std::thread t([&fut] {
+        std::cout << "start get x value\n";
+        int x = fut.get();
+        std::cout << "value: " << x << '\n';
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    prom.set_value(10);
+    t.join();
+}
+
+void Errors() {
+    LightPackagedTask<int(int)> task([](int x) -> int {
+        if(x < 0) {
+            throw std::invalid_argument("negative");
+        }
+        return x * 2;
+    });
+    LightFuture<int> fut = task.get_future();
+    task(-1);
+    try {
+        fut.get();
+    } catch(const std::invalid_argument& e) {
+        std::cout << "task threw: " << e.what() << '\n';
+    }
+
+    LightFuture<std::string> orphan;
+    {
+        LightPromise<std::string> prom;
+        orphan = prom.get_future();
+    }
+    try {
+        orphan.get();
+    } catch(const std::future_error& e) {
+        std::cout << "abandoned promise: " << e.code().message() << '\n';
+    }
+}
+
+template<template<typename> class Promise, template<typename> class Future>
+double SameThread(int n) {
+    auto start = Clock::now();
+    long long sum = 0;
+    for(int i = 0; i < n; ++i) {
+        Promise<int> prom;
+        Future<int> fut = prom.get_future();
+        prom.set_value(i);
+        sum += fut.get();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    if(sum != static_cast<long long>(n) * (n - 1) / 2) {
+        std::cout << "wrong sum " << sum << '\n';
+    }
+    return elapsed.count();
+}
+
+template<template<typename> class Promise, template<typename> class Future>
+double CrossThread(int n) {
+    std::vector<Promise<int>> promises(n);
+    std::vector<Future<int>> futures;
+    futures.reserve(n);
+    for(auto& prom : promises) {
+        futures.push_back(prom.get_future());
+    }
+    auto start = Clock::now();
+    std::thread producer([&promises] {
+        int i = 0;
+        for(auto& prom : promises) {
+            prom.set_value(i++);
+        }
+    });
+    long long sum = 0;
+    for(auto& fut : futures) {
+        sum += fut.get();
+    }
+    producer.join();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    if(sum != static_cast<long long>(n) * (n - 1) / 2) {
+        std::cout << "wrong sum " << sum << '\n';
+    }
+    return elapsed.count();
+}
+
+void Report(const char* name, int n, double seconds) {
+    std::cout << name << ": " << static_cast<long long>(n / seconds) << " futures/s" << '\n';
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if(n <= 0) {
+        std::cerr << "usage: LightFuture [count]" << std::endl;
+        return 1;
+    }
+    Handoff();
+    Errors();
+
+    Report("std same thread", n, SameThread<std::promise, std::future>(n));
+    Report("light same thread", n, SameThread<LightPromise, LightFuture>(n));
+    Report("std cross thread", n, CrossThread<std::promise, std::future>(n));
+    Report("light cross thread", n, CrossThread<LightPromise, LightFuture>(n));
+}
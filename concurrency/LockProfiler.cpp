@@ -0,0 +1,85 @@
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "lock_profiler.h"
+
+// 找出哪把锁是热点
+// 和chapter4_2.cpp一样使用std::lock_guard/std::unique_lock，只是把std::mutex换成ProfiledMutex，
+// 在调用点加上PROFILED_LOCK。程序退出时输出按总等待时间排序的报告。
+
+ProfiledMutex<> gAccountMtx(PROFILED_MUTEX_SITE("gAccountMtx"));
+ProfiledMutex<> gStatsMtx(PROFILED_MUTEX_SITE("gStatsMtx"));
+long long gBalance = 0;
+long long gStatsCount = 0;
+
+// 热点：持有锁期间做了不必要的计算
+void deposit(int amount) {
+    auto site = PROFILED_LOCK(gAccountMtx);
+    std::lock_guard<ProfiledLock<>> lock(site);
+    volatile int work = 0;
+    for(int i = 0; i < 200; ++i) {
+        work = work + i;
+    }
+    gBalance += amount;
+}
+// adopt_lock：先上锁，再交给lock_guard管理
+void withdraw(int amount) {
+    PROFILED_LOCK(gAccountMtx).lock();
+    std::lock_guard<ProfiledMutex<>> lock(gAccountMtx, std::adopt_lock);
+    gBalance -= amount;
+}
+// defer_lock + unique_lock，没有指定调用点，归属到gStatsMtx定义处
+void record_stats() {
+    std::unique_lock<ProfiledMutex<>> lock(gStatsMtx, std::defer_lock);
+    lock.lock();
+    ++gStatsCount;
+}
+
+// std::lock同时锁两把互斥量(和chapter4_2.cpp的task_b一样用defer_lock)，
+// 两个调用点各自归属到自己的互斥量，std::lock内部失败的try_lock不会串到别处
+void audit() {
+    auto account_site = PROFILED_LOCK(gAccountMtx);
+    auto stats_site = PROFILED_LOCK(gStatsMtx);
+    std::unique_lock<ProfiledLock<>> lck1(account_site, std::defer_lock);
+    std::unique_lock<ProfiledLock<>> lck2(stats_site, std::defer_lock);
+    std::lock(lck1, lck2);
+    gStatsCount += gBalance >= 0 ? 0 : 1;
+}
+
+void worker(int id) {
+    for(int i = 0; i < 20000; ++i) {
+        deposit(2);
+        withdraw(1);
+        if(i % 10 == id % 10) {
+            record_stats();
+        }
+        if(i % 100 == id) {
+            audit();
+        }
+    }
+}
+
+void run(int sample_every) {
+    SetLockProfileSampling(sample_every);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < 4; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "sampling 1 in " << sample_every << ": balance = " << gBalance
+              << ", stats = " << gStatsCount << ", " << elapsed.count() << " ms" << std::endl;
+}
+
+int main() {
+    // 第一轮测量每次上锁，第二轮每64次测量一次，比较开销
+    run(1);
+    DumpLockProfile(std::cout);
+    run(64);
+    ReportLockProfileAtExit();
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "prime_sieve.h"
+#include "thread_pool.h"
+
+/*
+PrimeSieve(prime_sieve.h)的演示
+
+1. 和逐个试除的结果对比，检查小范围内的判断以及十亿附近的一段区间。
+2. chapter6_3.cpp中用到的两个数：194232491和4444444443(后者超出了int，原来的is_prime(int)无法处理)。
+3. 统计[0, 10^k)中的素数个数，并与已知的pi(10^k)比较。
+
+用法：PrimeSieve [上限，默认10^9] [线程数]
+*/
+using Clock = std::chrono::steady_clock;
+
+// chapter6_3.cpp中的写法
+bool is_prime_naive(uint64_t x) {
+    for(uint64_t i = 2; i < x; ++i) {
+        if(x % i == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_prime_trial(uint64_t x) {
+    if(x < 2) {
+        return false;
+    }
+    for(uint64_t i = 2; i * i <= x; ++i) {
+        if(x % i == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t limit = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000000ull;
+    int threads = argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    if(limit < 100 || threads <= 0) {
+        std::cerr << "usage: PrimeSieve [limit >= 100] [threads]" << std::endl;
+        return 1;
+    }
+    // 4444444443也要能查询
+    uint64_t sieve_limit = limit > 4444444444ull ? limit : 4444444444ull;
+    ThreadPool pool(threads);
+    auto start = Clock::now();
+    PrimeSieve sieve(pool, sieve_limit);
+    std::cout << "sieve up to " << sieve_limit << " built in " << Seconds(start) << " s" << std::endl;
+
+    int mismatches = 0;
+    for(uint64_t n = 0; n < 100000; ++n) {
+        mismatches += sieve.is_prime(n) != is_prime_trial(n);
+    }
+    uint64_t lo = 1000000000ull - 5000;
+    uint64_t hi = 1000000000ull + 5000;
+    std::vector<uint64_t> expected;
+    for(uint64_t n = lo; n < hi; ++n) {
+        if(is_prime_trial(n)) {
+            expected.push_back(n);
+        }
+    }
+    mismatches += sieve.primes_in_range(lo, hi) != expected;
+    mismatches += sieve.count_primes(lo, hi) != expected.size();
+    std::cout << "checked against trial division: " << mismatches << " mismatches" << std::endl;
+
+    start = Clock::now();
+    bool naive = is_prime_naive(194232491);
+    double naive_seconds = Seconds(start);
+    start = Clock::now();
+    bool fast = sieve.is_prime(194232491);
+    std::cout << "194232491 " << (fast ? "is" : "is not") << " prime (naive " << naive_seconds
+              << " s, sieve " << Seconds(start) << " s" << (naive == fast ? "" : ", MISMATCH") << ")" << std::endl;
+    std::cout << "4444444443 " << (sieve.is_prime(4444444443ull) ? "is" : "is not") << " prime" << std::endl;
+
+    static const uint64_t kPi[] = {0, 4, 25, 168, 1229, 9592, 78498, 664579, 5761455, 50847534, 455052511,
+                                   4118054813ull};
+    uint64_t power = 10;
+    for(int k = 1; k < 12 && power <= limit; ++k, power *= 10) {
+        start = Clock::now();
+        uint64_t count = sieve.count_primes(0, power);
+        std::cout << "pi(10^" << k << ") = " << count << (count == kPi[k] ? "" : " (WRONG)")
+                  << " in " << Seconds(start) << " s" << std::endl;
+    }
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "item_repository.h"
+#include "mpmc_item_repository.h"
+
+// 多生产者多消费者，用关闭(close)代替全局计数器
+// ProducerAndComsumer4.cpp中生产者和消费者每轮都要锁住producted_item_counter_mtx或
+// consumed_item_counter_mtx，检查计数器来决定是否退出。
+// 这里每个生产者只负责自己的那一份产品，全部生产者结束后由主线程关闭产品库；
+// 消费者只在产品库上循环，取完剩余产品后ConsumeItem返回false，线程退出。
+// 热路径上不再有任何全局计数器的锁。
+
+static const int kItemsToProduce = 100000; // How many items we plan to produce.
+static const int kProducerCount = 4;
+static const int kConsumerCount = 4;
+
+// 生产者任务：生产编号为first, first + step, first + 2 * step, ...的产品
+template<typename Repository>
+void ProducerTask(Repository& ir, int first, int step) {
+    for(int item = first; item <= kItemsToProduce; item += step) {
+        ProduceItem(ir, item);
+    }
+}
+// 消费者任务：一直取到产品流结束
+template<typename Repository>
+void ConsumerTask(Repository& ir, std::atomic<long long>& total) {
+    long long sum = 0;
+    int item;
+    while(ConsumeItem(ir, item)) {
+        sum += item;
+    }
+    total += sum;
+}
+
+template<typename Repository>
+void run(const char* name, Repository& ir) {
+    std::atomic<long long> total(0);
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+    for(int i = 0; i < kProducerCount; ++i) {
+        producers.emplace_back(ProducerTask<Repository>, std::ref(ir), i + 1, kProducerCount);
+    }
+    for(int i = 0; i < kConsumerCount; ++i) {
+        consumers.emplace_back(ConsumerTask<Repository>, std::ref(ir), std::ref(total));
+    }
+    for(auto& th : producers) {
+        th.join();
+    }
+    // 所有产品都已生产，关闭产品库，消费者取完剩余产品后退出
+    CloseItemRepository(ir);
+    for(auto& th : consumers) {
+        th.join();
+    }
+    long long expect = static_cast<long long>(kItemsToProduce) * (kItemsToProduce + 1) / 2;
+    std::cout << name << ": sum = " << total << (total == expect ? " (ok)" : " (mismatch)")
+              << ", produce after close " << (ProduceItem(ir, 1) == ProduceStatus::kClosed ? "rejected" : "accepted") << std::endl;
+}
+
+ItemRepository<int, 16> gItemRepository;
+MpmcItemRepository<int, 16> gMpmcItemRepository;
+
+int main() {
+    run("ItemRepository", gItemRepository);
+    run("MpmcItemRepository", gMpmcItemRepository);
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sharded_item_repository.h"
+
+// 多生产者多消费者，分片产品库 + 工作窃取
+// 每个消费者有自己的主分片，生产者轮流把产品放入各个分片，
+// 消费者的主分片空了就从其他分片窃取，因此慢消费者积压的产品会被其他消费者分担。
+
+static const int kItemsToProduce = 100000; // How many items we plan to produce.
+static const int kProducerCount = 4;
+static const int kConsumerCount = 8;
+
+ShardedItemRepository<int, 256> gItemRepository(kConsumerCount);
+
+std::atomic<long long> gConsumedItemSum(0);
+
+// 生产者任务
+void ProducerTask(int first) {
+    for(int item = first; item <= kItemsToProduce; item += kProducerCount) {
+        ProduceItem(gItemRepository, item);
+    }
+}
+// 消费者任务，0号消费者故意慢一些，它的分片中的产品会被其他消费者窃取
+void ConsumerTask(int id, int& consumed) {
+    long long sum = 0;
+    int item;
+    while(ConsumeItem(gItemRepository, item)) {
+        if(id == 0) {
+            std::this_thread::yield();
+        }
+        sum += item;
+        ++consumed;
+    }
+    gConsumedItemSum += sum;
+}
+
+void test1() {
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+    std::vector<int> consumed(kConsumerCount, 0);
+    for(int i = 0; i < kProducerCount; ++i) {
+        producers.emplace_back(ProducerTask, i + 1);
+    }
+    for(int i = 0; i < kConsumerCount; ++i) {
+        consumers.emplace_back(ConsumerTask, i, std::ref(consumed[i]));
+    }
+    for(auto& th : producers) {
+        th.join();
+    }
+    CloseItemRepository(gItemRepository);
+    for(auto& th : consumers) {
+        th.join();
+    }
+    long long expect = static_cast<long long>(kItemsToProduce) * (kItemsToProduce + 1) / 2;
+    std::cout << "sum = " << gConsumedItemSum << (gConsumedItemSum == expect ? " (ok)" : " (mismatch)") << std::endl;
+    for(int i = 0; i < kConsumerCount; ++i) {
+        std::cout << "consumer " << i << " consumed " << consumed[i] << " items" << std::endl;
+    }
+}
+
+// 按key分片：同一个用户的消息进入同一个分片
+void test2() {
+    ShardedItemRepository<std::string, 16> ir(4);
+    ProduceItemByKey(ir, std::string("alice"), std::string("alice: hello"));
+    ProduceItemByKey(ir, std::string("bob"), std::string("bob: hi"));
+    ProduceItemByKey(ir, std::string("alice"), std::string("alice: bye"));
+    CloseItemRepository(ir);
+    std::string message;
+    while(ConsumeItem(ir, message)) {
+        std::cout << message << std::endl;
+    }
+}
+
+int main() {
+    test1();
+    test2();
+}
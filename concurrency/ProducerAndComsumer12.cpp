@@ -0,0 +1,133 @@
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "pipeline_item_repository.h"
+#include "spsc_item_repository.h"
+
+// 多阶段流水线：produce -> parse -> enrich -> sink
+// 用3个SpscItemRepository把4个线程串起来时，每条记录在每一跳都要被移出再放入下一个产品库；
+// PipelineItemRepository中记录只写入一次，parse/enrich/sink三个阶段直接在槽位上处理，
+// 每个阶段只等待上一个阶段的游标。
+
+static const int kItemsToProduce = 200000; // How many items we plan to produce.
+
+struct Record {
+    char raw[32];      // 生产者写入的原始文本 "id,value"
+    int id = 0;        // parse阶段填写
+    int value = 0;     // parse阶段填写
+    long long score = 0; // enrich阶段填写
+};
+
+Record MakeRecord(int i) {
+    Record record;
+    std::snprintf(record.raw, sizeof(record.raw), "%d,%d", i, i % 1000);
+    return record;
+}
+void Parse(Record& record) {
+    char* end;
+    record.id = static_cast<int>(std::strtol(record.raw, &end, 10));
+    record.value = static_cast<int>(std::strtol(end + 1, nullptr, 10));
+}
+void Enrich(Record& record) {
+    record.score = static_cast<long long>(record.id) + record.value;
+}
+
+long long Expected() {
+    long long sum = 0;
+    for(int i = 1; i <= kItemsToProduce; ++i) {
+        sum += i + i % 1000;
+    }
+    return sum;
+}
+
+void report(const char* name, long long sum, std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": sum = " << sum << (sum == Expected() ? " (ok)" : " (mismatch)")
+              << ", " << elapsed.count() << " ms" << std::endl;
+}
+
+// 链式产品库中id为0的记录表示流结束
+SpscItemRepository<Record, 1024> gRawRepository;
+SpscItemRepository<Record, 1024> gParsedRepository;
+SpscItemRepository<Record, 1024> gEnrichedRepository;
+
+void test1() {
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    std::thread producer([] {
+        for(int i = 1; i <= kItemsToProduce; ++i) {
+            ProduceItem(gRawRepository, MakeRecord(i));
+        }
+        ProduceItem(gRawRepository, MakeRecord(0));
+    });
+    std::thread parser([] {
+        while(1) {
+            Record record = ConsumeItem(gRawRepository);
+            Parse(record);
+            ProduceItem(gParsedRepository, record);
+            if(record.id == 0) {
+                break;
+            }
+        }
+    });
+    std::thread enricher([] {
+        while(1) {
+            Record record = ConsumeItem(gParsedRepository);
+            Enrich(record);
+            ProduceItem(gEnrichedRepository, record);
+            if(record.id == 0) {
+                break;
+            }
+        }
+    });
+    std::thread sink([&sum] {
+        while(1) {
+            Record record = ConsumeItem(gEnrichedRepository);
+            if(record.id == 0) {
+                break;
+            }
+            sum += record.score;
+        }
+    });
+    producer.join();
+    parser.join();
+    enricher.join();
+    sink.join();
+    report("chained SpscItemRepository", sum, start);
+}
+
+// 阶段0: parse，阶段1: enrich，阶段2: sink
+PipelineItemRepository<Record, 3, 1024> gPipeline;
+
+void test2() {
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    std::thread producer([] {
+        for(int i = 1; i <= kItemsToProduce; ++i) {
+            EmplaceItem(gPipeline, MakeRecord(i));
+        }
+        // 生产结束，各阶段处理完剩余记录后退出
+        CloseItemRepository(gPipeline);
+    });
+    std::thread parser([] {
+        while(ProcessItems(gPipeline, 0, Parse) != 0) {}
+    });
+    std::thread enricher([] {
+        while(ProcessItems(gPipeline, 1, Enrich) != 0) {}
+    });
+    std::thread sink([&sum] {
+        while(ProcessItems(gPipeline, 2, [&sum](Record& record) { sum += record.score; }) != 0) {}
+    });
+    producer.join();
+    parser.join();
+    enricher.join();
+    sink.join();
+    report("PipelineItemRepository", sum, start);
+}
+
+int main() {
+    test1();
+    test2();
+}
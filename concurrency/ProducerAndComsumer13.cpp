@@ -0,0 +1,67 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shm_item_repository.h"
+
+// 跨进程的生产者消费者
+// 生产者和消费者是不同的进程(fork之后各自按名字映射同一块共享内存)，
+// 产品直接写进共享内存中的MPMC环形缓冲区，不经过socket或管道，也不需要序列化。
+// 缓冲区满/空时在共享内存中的futex上等待，对方进程生产/消费后把它唤醒。
+
+static const int kItemsToProduce = 100000; // How many items we plan to produce.
+static const int kConsumerCount = 2;
+static const char* kShmName = "/ProducerAndComsumer13";
+
+// 放进共享内存的产品只能包含可平凡拷贝、不含指针的数据
+struct Order {
+    int id;
+    int quantity;
+    char symbol[8];
+};
+
+using OrderRepository = ShmMpmcItemRepository<Order, 256>;
+
+// 消费者进程：按名字打开共享内存，一直取到生产者关闭产品库
+int ConsumerProcess(int index) {
+    ShmItemRepository<OrderRepository> shm = ShmItemRepository<OrderRepository>::Open(kShmName);
+    long long sum = 0;
+    int count = 0;
+    Order order;
+    while(ConsumeItem(*shm, order)) {
+        sum += order.id;
+        ++count;
+    }
+    std::printf("consumer %d (pid %d): %d orders, id sum %lld\n", index, getpid(), count, sum);
+    // 子进程用_exit退出，不会刷新stdio缓冲区
+    std::fflush(stdout);
+    return 0;
+}
+
+int main() {
+    // 清理上次异常退出留下的同名对象
+    ShmItemRepository<OrderRepository>::Unlink(kShmName);
+    ShmItemRepository<OrderRepository> shm = ShmItemRepository<OrderRepository>::Create(kShmName);
+
+    pid_t consumers[kConsumerCount];
+    for(int i = 0; i < kConsumerCount; ++i) {
+        std::fflush(stdout);
+        consumers[i] = fork();
+        if(consumers[i] == 0) {
+            _exit(ConsumerProcess(i));
+        }
+    }
+
+    // 本进程作为生产者
+    for(int i = 1; i <= kItemsToProduce; ++i) {
+        Order order = {i, i % 100, "ACME"};
+        ProduceItem(*shm, order);
+    }
+    CloseItemRepository(*shm);
+    for(int i = 0; i < kConsumerCount; ++i) {
+        waitpid(consumers[i], nullptr, 0);
+    }
+    long long expect = static_cast<long long>(kItemsToProduce) * (kItemsToProduce + 1) / 2;
+    std::cout << "producer (pid " << getpid() << "): expected id sum " << expect << std::endl;
+}
@@ -0,0 +1,47 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include "spsc_item_repository.h"
+
+// 单生产者单消费者，无锁环形队列版本
+// 与ProducerAndComsumer1.cpp相同的场景，但ItemRepository换成SpscItemRepository，
+// 热路径上没有互斥量和条件变量，只有在缓冲区真的满或空时才在futex上睡眠。
+
+static const int kItemsToProduce = 10000000; // How many items we plan to produce.
+
+SpscItemRepository<int> gItemRepository; // 产品库全局变量，生产者和消费者操作该变量
+
+// 生产者任务
+void ProducerTask() {
+    for(int i = 1; i <= kItemsToProduce; ++i) {
+        ProduceItem(gItemRepository, i);
+    }
+}
+// 消费者任务
+void ConsumerTask() {
+    long long sum = 0;
+    for(int cnt = 1; cnt <= kItemsToProduce; ++cnt) {
+        // 消费一个产品，SPSC保证产品按生产顺序到达
+        int item = ConsumeItem(gItemRepository);
+        if(item != cnt) {
+            std::cout << "Unexpected item " << item << ", expect " << cnt << std::endl;
+        }
+        sum += item;
+    }
+    std::cout << "Consumed " << kItemsToProduce << " items, sum = " << sum << std::endl;
+}
+
+int main() {
+    InitItemRepository(gItemRepository);
+    auto start = std::chrono::steady_clock::now();
+    // 生产者进程
+    std::thread producer(ProducerTask);
+    // 消费者进程
+    std::thread consumer(ConsumerTask);
+
+    producer.join();
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "elapsed " << elapsed.count() << "s, "
+              << kItemsToProduce / elapsed.count() << " items/s" << std::endl;
+}
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "mpmc_item_repository.h"
+
+// 多生产者多消费者，有界无锁队列版本
+// 与ProducerAndComsumer4.cpp相同的场景，ItemRepository换成MpmcItemRepository。
+// 原版本中生产者/消费者计数器各需要一把互斥量，这里改为原子变量上的fetch_add：
+// 每个线程先领取一个编号，编号小于kItemsToProduce才去生产/消费，
+// 因此每个产品恰好被生产一次、消费一次，热路径上没有任何锁。
+
+static const int kItemsToProduce = 4000000; // How many items we plan to produce.
+static const int kProducerCount = 4;
+static const int kConsumerCount = 4;
+
+MpmcItemRepository<int> gItemRepository; // 产品库全局变量，生产者和消费者操作该变量
+
+std::atomic<int> gProductedItemCounter(0);
+std::atomic<int> gConsumedItemCounter(0);
+std::atomic<long long> gConsumedItemSum(0);
+
+// 生产者任务
+void ProducerTask() {
+    while(1) {
+        int item = gProductedItemCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+        if(item > kItemsToProduce) {
+            break;
+        }
+        ProduceItem(gItemRepository, item);
+    }
+}
+// 消费者任务
+void ConsumerTask() {
+    long long sum = 0;
+    while(gConsumedItemCounter.fetch_add(1, std::memory_order_relaxed) < kItemsToProduce) {
+        sum += ConsumeItem(gItemRepository);
+    }
+    gConsumedItemSum += sum;
+}
+
+int main() {
+    InitItemRepository(gItemRepository);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    // 生产者进程
+    for(int i = 0; i < kProducerCount; ++i) {
+        threads.emplace_back(ProducerTask);
+    }
+    // 消费者进程
+    for(int i = 0; i < kConsumerCount; ++i) {
+        threads.emplace_back(ConsumerTask);
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    long long expect = static_cast<long long>(kItemsToProduce) * (kItemsToProduce + 1) / 2;
+    std::cout << "sum = " << gConsumedItemSum << (gConsumedItemSum == expect ? " (ok)" : " (mismatch)")
+              << std::endl;
+    std::cout << "elapsed " << elapsed.count() << "s, "
+              << kItemsToProduce / elapsed.count() << " items/s" << std::endl;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "item_repository.h"
+
+// 单生产者单消费者，批量生产/消费
+// 对比逐个搬运(ProduceItem/ConsumeItem)与批量搬运(ProduceItems/ConsumeItems)的吞吐量。
+// 批量接口把一次加锁和一次notify分摊到kBatchSize个产品上。
+
+static const int kItemsToProduce = 2000000; // How many items we plan to produce.
+static const std::size_t kBatchSize = 128;
+
+ItemRepository<int> gItemRepository; // 产品库全局变量，生产者和消费者操作该变量
+
+// 逐个生产
+void ProducerTask() {
+    for(int i = 1; i <= kItemsToProduce; ++i) {
+        ProduceItem(gItemRepository, i);
+    }
+}
+// 逐个消费
+void ConsumerTask() {
+    long long sum = 0;
+    for(int cnt = 0; cnt < kItemsToProduce; ++cnt) {
+        sum += ConsumeItem(gItemRepository);
+    }
+    std::cout << "sum = " << sum << std::endl;
+}
+// 批量生产
+void BatchProducerTask() {
+    std::vector<int> batch(kBatchSize);
+    for(int i = 1; i <= kItemsToProduce; ) {
+        std::size_t n = 0;
+        for(; n < kBatchSize && i <= kItemsToProduce; ++n, ++i) {
+            batch[n] = i;
+        }
+        ProduceItems(gItemRepository, batch.data(), n);
+    }
+}
+// 批量消费
+void BatchConsumerTask() {
+    std::vector<int> batch(kBatchSize);
+    long long sum = 0;
+    for(int cnt = 0; cnt < kItemsToProduce; ) {
+        std::size_t n = ConsumeItems(gItemRepository, batch.data(), batch.size());
+        for(std::size_t i = 0; i < n; ++i) {
+            sum += batch[i];
+        }
+        cnt += static_cast<int>(n);
+    }
+    std::cout << "sum = " << sum << std::endl;
+}
+
+void run(const char* name, void (*producer_task)(), void (*consumer_task)()) {
+    InitItemRepository(gItemRepository);
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer(producer_task);
+    std::thread consumer(consumer_task);
+    producer.join();
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << kItemsToProduce / elapsed.count() << " items/s" << std::endl;
+}
+
+int main() {
+    run("one by one", ProducerTask, ConsumerTask);
+    run("batched", BatchProducerTask, BatchConsumerTask);
+}
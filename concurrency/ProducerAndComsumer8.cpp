@@ -0,0 +1,85 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "item_repository.h"
+#include "mpmc_item_repository.h"
+#include "spsc_item_repository.h"
+
+// 泛型ItemRepository<T, Capacity>
+// 1. 产品可以是只能移动的类型，例如std::unique_ptr管理的大缓冲区，
+//    生产者把指针移动进槽位，消费者再移动出来，缓冲区本身从不拷贝。
+// 2. EmplaceItem在槽位上原地构造产品，不需要先构造一个临时对象。
+// 3. 容量向上取整为2的幂，例如ItemRepository<T, 100>的容量为128。
+
+static const int kItemsToProduce = 1000; // How many items we plan to produce.
+static const std::size_t kPayloadSize = 64 * 1024;
+
+using Buffer = std::unique_ptr<std::vector<char>>;
+
+// 生产者先填好缓冲区，再把所有权交给产品库
+template<typename Repository>
+void ProducerTask(Repository& ir) {
+    for(int i = 1; i <= kItemsToProduce; ++i) {
+        Buffer buffer(new std::vector<char>(kPayloadSize, static_cast<char>(i)));
+        ProduceItem(ir, std::move(buffer));
+    }
+}
+// 消费者取得缓冲区的所有权，用完自动释放
+template<typename Repository>
+void ConsumerTask(Repository& ir) {
+    int bad = 0;
+    for(int i = 1; i <= kItemsToProduce; ++i) {
+        Buffer buffer = ConsumeItem(ir);
+        if(buffer->size() != kPayloadSize || (*buffer)[0] != static_cast<char>(i)) {
+            ++bad;
+        }
+    }
+    std::cout << "consumed " << kItemsToProduce << " buffers, " << bad << " bad" << std::endl;
+}
+
+template<typename Repository>
+void run(const char* name, Repository& ir) {
+    std::cout << name << " (capacity " << ir.kCapacity << "): ";
+    std::thread producer(ProducerTask<Repository>, std::ref(ir));
+    std::thread consumer(ConsumerTask<Repository>, std::ref(ir));
+    producer.join();
+    consumer.join();
+}
+
+ItemRepository<Buffer, 100> gItemRepository;
+SpscItemRepository<Buffer, 100> gSpscItemRepository;
+MpmcItemRepository<Buffer, 100> gMpmcItemRepository;
+
+void test1() {
+    run("ItemRepository", gItemRepository);
+    run("SpscItemRepository", gSpscItemRepository);
+    run("MpmcItemRepository", gMpmcItemRepository);
+}
+
+// EmplaceItem: 直接用构造参数在槽位上构造产品
+struct Message {
+    Message(int id, std::string text) : id(id), text(std::move(text)) {}
+    Message(const Message&) = delete;
+    Message(Message&&) = default;
+    Message& operator=(Message&&) = default;
+    int id;
+    std::string text;
+};
+
+void test2() {
+    ItemRepository<Message, 4> ir;
+    EmplaceItem(ir, 1, "hello");
+    EmplaceItem(ir, 2, "world");
+    // 没有被取走的产品由ItemRepository的析构函数销毁
+    EmplaceItem(ir, 3, "left in repository");
+    Message m1 = ConsumeItem(ir);
+    Message m2 = ConsumeItem(ir);
+    std::cout << m1.id << ": " << m1.text << ", " << m2.id << ": " << m2.text << std::endl;
+}
+
+int main() {
+    test1();
+    test2();
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include "item_repository.h"
+
+// 缓冲区满时的处理方式(背压与溢出策略)
+// 生产者比消费者快得多时，默认的kBlock会让生产者停下来等待消费者；
+// 对网络收包这样不能停下来的生产者，可以选择丢弃新产品、覆盖旧产品，
+// 或者最多等待一段时间。每种策略都有计数器记录丢弃/覆盖/超时了多少产品。
+
+static const int kItemsToProduce = 200; // How many items we plan to produce.
+
+// 消费者每隔1ms取一个产品，比生产者慢，取到结束标记0时退出
+void SlowConsumerTask(ItemRepository<int, 8>& ir) {
+    while(ConsumeItem(ir) != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void run(const char* name, OverflowPolicy policy,
+         std::chrono::nanoseconds timeout = std::chrono::nanoseconds(0)) {
+    ItemRepository<int, 8> ir;
+    SetOverflowPolicy(ir, policy, timeout);
+    std::thread consumer(SlowConsumerTask, std::ref(ir));
+    int not_stored = 0;
+    // 生产者每隔100us生产一个产品
+    for(int i = 1; i <= kItemsToProduce; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        ProduceStatus status = ProduceItem(ir, i);
+        if(status == ProduceStatus::kDropped || status == ProduceStatus::kTimeout) {
+            ++not_stored;
+        }
+    }
+    // 结束标记不能被丢弃，改回kBlock再生产
+    SetOverflowPolicy(ir, OverflowPolicy::kBlock);
+    ProduceItem(ir, 0);
+    consumer.join();
+    OverflowStats stats = GetOverflowStats(ir);
+    std::cout << name << ": produced " << stats.produced
+              << ", dropped " << stats.dropped
+              << ", overwritten " << stats.overwritten
+              << ", timed out " << stats.timed_out
+              << " (producer saw " << not_stored << " rejected)" << std::endl;
+}
+
+void test1() {
+    run("block", OverflowPolicy::kBlock);
+    run("drop newest", OverflowPolicy::kDropNewest);
+    run("overwrite oldest", OverflowPolicy::kOverwriteOldest);
+    run("block with timeout", OverflowPolicy::kBlockWithTimeout, std::chrono::microseconds(500));
+}
+
+// 批量生产时，放不下的部分按同样的策略处理，返回实际放入的产品数
+void test2() {
+    ItemRepository<int, 8> ir;
+    int items[20];
+    for(int i = 0; i < 20; ++i) {
+        items[i] = i + 1;
+    }
+    SetOverflowPolicy(ir, OverflowPolicy::kDropNewest);
+    std::cout << "drop newest batch accepted " << ProduceItems(ir, items, 20) << std::endl;
+    SetOverflowPolicy(ir, OverflowPolicy::kOverwriteOldest);
+    std::cout << "overwrite oldest batch accepted " << ProduceItems(ir, items, 20) << std::endl;
+    // 缓冲区中留下的是最新的8个产品：13~20
+    int out[8];
+    std::size_t n = ConsumeItems(ir, out, 8);
+    for(std::size_t i = 0; i < n; ++i) {
+        std::cout << out[i] << ' ';
+    }
+    std::cout << std::endl;
+}
+
+int main() {
+    test1();
+    test2();
+}
@@ -0,0 +1,208 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "seqlock.h"
+#include "shared_mutex.h"
+
+/*
+读多写少的共享状态基准测试
+
+chapter4_2.cpp、chapter5_1.cpp中的共享数据都用std::mutex保护。
+这里让多个线程按给定的读比例反复读/写一个小的共享状态(一组报价)，
+比较std::mutex、std::shared_mutex、SharedMutex(shared_mutex.h)和SeqLock(seqlock.h)的吞吐量。
+报价满足ask == bid + 1，读者每次检查这个不变式，读到被撕裂的状态就计数(应当始终为0)。
+每次运行输出一行JSON。
+
+用法：
+SharedStateBenchmark [--engine=mutex|std_shared_mutex|shared_mutex|seqlock|all]
+                     [--threads=N] [--ops=N] [--read_ratio=0.999]
+不带--read_ratio时依次测试50%、90%、99%、99.9%的读比例。
+*/
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    std::string engine = "all";
+    int threads = 4;
+    long long ops = 1000000; // 每个线程的操作数
+    double read_ratio = -1;
+};
+
+struct Quote {
+    int64_t bid;
+    int64_t ask;
+    int64_t timestamp;
+    int64_t version;
+};
+
+Quote MakeQuote(int64_t version) {
+    return Quote{version * 10, version * 10 + 1, version, version};
+}
+
+// 每个线程自己的伪随机数(xorshift)，决定这次是读还是写
+struct XorShift {
+    explicit XorShift(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+    uint64_t Next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+    uint64_t state;
+};
+
+// 用互斥量保护的报价，ReadLock决定读者用独占锁(lock_guard)还是共享锁(shared_lock)
+template<typename Mutex, template<typename> class ReadLock>
+struct LockedQuote {
+    Mutex mtx;
+    Quote quote = MakeQuote(0);
+
+    Quote Read() {
+        ReadLock<Mutex> lock(mtx);
+        return quote;
+    }
+    void Write(const Quote& q) {
+        std::lock_guard<Mutex> lock(mtx);
+        quote = q;
+    }
+};
+
+struct SeqLockQuote {
+    SeqLock<Quote> quote{MakeQuote(0)};
+
+    Quote Read() {
+        return quote.Load();
+    }
+    void Write(const Quote& q) {
+        quote.Store(q);
+    }
+};
+
+template<typename State>
+void RunOne(const std::string& engine, const BenchConfig& config, double read_ratio) {
+    State state;
+    std::atomic<long long> torn(0);
+    std::vector<std::thread> threads;
+    uint64_t read_threshold = static_cast<uint64_t>(read_ratio * 1000000);
+    auto start = Clock::now();
+    for(int t = 0; t < config.threads; ++t) {
+        threads.emplace_back([&state, &torn, &config, read_threshold, t] {
+            XorShift rng(t + 1);
+            long long bad = 0;
+            for(long long i = 0; i < config.ops; ++i) {
+                if(rng.Next() % 1000000 < read_threshold) {
+                    Quote q = state.Read();
+                    if(q.ask != q.bid + 1) {
+                        ++bad;
+                    }
+                } else {
+                    state.Write(MakeQuote(i * config.threads + t));
+                }
+            }
+            torn += bad;
+        });
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    long long total = config.ops * config.threads;
+    std::cout << "{\"engine\":\"" << engine << "\""
+              << ",\"threads\":" << config.threads
+              << ",\"read_ratio\":" << read_ratio
+              << ",\"ops\":" << total
+              << ",\"seconds\":" << elapsed.count()
+              << ",\"ops_per_sec\":" << static_cast<long long>(total / elapsed.count())
+              << ",\"torn_reads\":" << torn
+              << "}" << std::endl;
+}
+
+// SharedMutex默认按CPU核数分条，和其他互斥量一样可以默认构造
+using StdMutexQuote = LockedQuote<std::mutex, std::lock_guard>;
+using StdSharedMutexQuote = LockedQuote<std::shared_mutex, std::shared_lock>;
+using SharedMutexQuote = LockedQuote<SharedMutex, std::shared_lock>;
+
+void RunEngines(const BenchConfig& config, double read_ratio) {
+    bool all = config.engine == "all";
+    if(all || config.engine == "mutex") {
+        RunOne<StdMutexQuote>("mutex", config, read_ratio);
+    }
+    if(all || config.engine == "std_shared_mutex") {
+        RunOne<StdSharedMutexQuote>("std_shared_mutex", config, read_ratio);
+    }
+    if(all || config.engine == "shared_mutex") {
+        RunOne<SharedMutexQuote>("shared_mutex", config, read_ratio);
+    }
+    if(all || config.engine == "seqlock") {
+        RunOne<SeqLockQuote>("seqlock", config, read_ratio);
+    }
+}
+
+void PrintUsage(const char* prog) {
+    std::cerr << "usage: " << prog << " [--engine=mutex|std_shared_mutex|shared_mutex|seqlock|all]\n"
+              << "        [--threads=N] [--ops=N] [--read_ratio=0.999]" << std::endl;
+}
+
+bool IsKnownEngine(const std::string& engine) {
+    for(const char* name : {"mutex", "std_shared_mutex", "shared_mutex", "seqlock", "all"}) {
+        if(engine == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseArg(const char* arg, BenchConfig& config) {
+    const char* eq = std::strchr(arg, '=');
+    if(std::strncmp(arg, "--", 2) != 0 || eq == nullptr) {
+        return false;
+    }
+    std::string key(arg + 2, eq);
+    const char* value = eq + 1;
+    if(key == "engine") {
+        // 拼错的engine名不能悄悄什么都不跑
+        if(!IsKnownEngine(value)) {
+            std::cerr << "unknown engine: " << value << std::endl;
+            return false;
+        }
+        config.engine = value;
+    } else if(key == "threads") {
+        config.threads = std::atoi(value);
+    } else if(key == "ops") {
+        config.ops = std::atoll(value);
+    } else if(key == "read_ratio") {
+        config.read_ratio = std::atof(value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    for(int i = 1; i < argc; ++i) {
+        if(!ParseArg(argv[i], config)) {
+            std::cerr << "unknown argument: " << argv[i] << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if(config.threads <= 0 || config.ops <= 0 || config.read_ratio > 1) {
+        std::cerr << "threads and ops must be positive, read_ratio at most 1" << std::endl;
+        return 1;
+    }
+    if(config.read_ratio >= 0) {
+        RunEngines(config, config.read_ratio);
+        return 0;
+    }
+    for(double read_ratio : {0.5, 0.9, 0.99, 0.999}) {
+        RunEngines(config, read_ratio);
+    }
+}
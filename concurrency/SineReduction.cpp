@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "parallel_reduce.h"
+#include "simd_sine.h"
+#include "thread_pool.h"
+
+/*
+chapter6_3.cpp中ThreadTask(sin(0) + sin(1) + ... + sin(n-1))的并行向量化版本
+
+1. ThreadTask: 单线程逐个调用std::sin再累加(原来的写法)。
+2. SineSum: 单线程，按指令集(标量/AVX2/AVX-512)一次计算多个正弦值，通道内Kahan求和。
+3. parallel_reduce + SineSum: 固定大小的块分给线程池，部分和两两相加。
+   用不同的线程数各算一遍，结果应当逐位相同。
+误差相对于用long double累加std::sin得到的参考值。
+
+用法：SineReduction [n] [最大线程数]
+*/
+using Clock = std::chrono::steady_clock;
+
+static const int64_t kGrain = 1 << 16;
+
+double ThreadTask(int64_t n) {
+    double ret = 0;
+    for(int64_t i = 0; i < n; ++i) {
+        ret += std::sin(static_cast<double>(i));
+    }
+    return ret;
+}
+
+long double Reference(int64_t n) {
+    long double ret = 0;
+    for(int64_t i = 0; i < n; ++i) {
+        ret += std::sin(static_cast<long double>(i));
+    }
+    return ret;
+}
+
+template<typename F>
+double Timed(F&& f, double& seconds) {
+    auto start = Clock::now();
+    double result = f();
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+void Report(const char* name, double value, long double reference, double seconds, double baseline) {
+    std::printf("%-28s %.15e  error %.3e  %8.3f s  speedup %6.2fx\n", name, value,
+                static_cast<double>(std::fabs(value - reference)), seconds, baseline / seconds);
+}
+
+int main(int argc, char* argv[]) {
+    int64_t n = argc > 1 ? std::atoll(argv[1]) : 20000000;
+    int max_threads = argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    if(n <= 0 || max_threads <= 0) {
+        std::cerr << "usage: SineReduction [n] [max_threads]" << std::endl;
+        return 1;
+    }
+    long double reference = Reference(n);
+    std::printf("n = %lld, reference %.15Le\n", static_cast<long long>(n), reference);
+
+    double baseline;
+    double value = Timed([n] { return ThreadTask(n); }, baseline);
+    Report("ThreadTask (std::sin)", value, reference, baseline, baseline);
+
+    SimdLevel best = DetectSimdLevel();
+    std::vector<SimdLevel> levels{SimdLevel::kScalar};
+    if(best == SimdLevel::kAvx2 || best == SimdLevel::kAvx512) {
+        levels.push_back(SimdLevel::kAvx2);
+    }
+    if(best == SimdLevel::kAvx512) {
+        levels.push_back(SimdLevel::kAvx512);
+    }
+    for(SimdLevel level : levels) {
+        char name[64];
+        double seconds;
+        value = Timed([n, level] { return SineSum(0, n, level); }, seconds);
+        std::snprintf(name, sizeof(name), "SineSum %s", SimdLevelName(level));
+        Report(name, value, reference, seconds, baseline);
+    }
+
+    double first = 0;
+    bool deterministic = true;
+    for(int threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool pool(threads);
+        char name[64];
+        double seconds;
+        value = Timed([&pool, n, best] {
+            return parallel_reduce(pool, int64_t(0), n, kGrain,
+                                   [best](int64_t begin, int64_t end) { return SineSum(begin, end, best); });
+        }, seconds);
+        std::snprintf(name, sizeof(name), "parallel %s x%d", SimdLevelName(best), threads);
+        Report(name, value, reference, seconds, baseline);
+        if(threads == 1) {
+            first = value;
+        } else if(value != first) {
+            deterministic = false;
+        }
+    }
+    std::printf("parallel results %s across thread counts\n", deterministic ? "identical" : "DIFFER");
+}
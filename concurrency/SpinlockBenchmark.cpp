@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spinlock.h"
+
+/*
+自旋锁的扩展性基准测试
+
+chapter7_1.cpp的append_number用atomic_flag自旋锁保护一个共享的stringstream。
+这里让多个线程在给定的时间内反复加锁、执行一段很短的临界区、解锁、再做一点临界区外的工作，
+比较TasSpinlock、TtasSpinlock、TicketSpinlock和McsSpinlock(spinlock.h)：
+- acquisitions_per_sec: 总吞吐量。
+- wait_p50_ns/wait_p99_ns/wait_p999_ns: 每次lock()等待时间的分位数(尾延迟)。
+- fairness: 获得锁最多的线程和最少的线程的次数之比，1表示完全公平，TAS/TTAS在竞争激烈时会明显偏大。
+- lost_updates: 临界区内计数器的丢失次数，应当始终为0。
+每次运行输出一行JSON。
+
+等待期间的cache line流量无法在程序内部测量，可以用硬件计数器观察，例如：
+perf stat -e cache-misses,bus-cycles ./SpinlockBenchmark --lock=tas --threads=8
+
+用法：
+SpinlockBenchmark [--lock=tas|ttas|ticket|mcs|all] [--threads=N] [--millis=N]
+不带--threads时依次测试1、2、4、8个线程。
+*/
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    std::string lock = "all";
+    int threads = 0;
+    int millis = 500;
+};
+
+// 临界区内外做的一点工作，防止编译器把循环优化掉
+static const int kCriticalWork = 20;
+static const int kOutsideWork = 200;
+
+inline uint64_t Work(uint64_t x, int rounds) {
+    for(int i = 0; i < rounds; ++i) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return x;
+}
+
+struct alignas(kCacheLineSize) ThreadResult {
+    long long acquisitions = 0;
+    std::vector<int64_t> wait_ns;
+};
+
+int64_t Percentile(const std::vector<int64_t>& sorted, double p) {
+    if(sorted.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+template<typename Lock>
+void RunOne(const std::string& name, int thread_count, int millis) {
+    Lock lock;
+    long long shared_counter = 0;
+    uint64_t shared_state = 0;
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<ThreadResult> results(thread_count);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            ThreadResult& result = results[t];
+            result.wait_ns.reserve(1 << 20);
+            uint64_t local = t + 1;
+            while(!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            while(!stop.load(std::memory_order_relaxed)) {
+                auto begin = Clock::now();
+                lock.lock();
+                auto acquired = Clock::now();
+                ++shared_counter;
+                shared_state = Work(shared_state + local, kCriticalWork);
+                lock.unlock();
+                result.wait_ns.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(acquired - begin).count());
+                ++result.acquisitions;
+                local = Work(local, kOutsideWork);
+            }
+        });
+    }
+    auto begin = Clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+    stop.store(true, std::memory_order_relaxed);
+    for(auto& th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - begin;
+
+    long long total = 0;
+    long long most = 0;
+    long long least = -1;
+    std::vector<int64_t> waits;
+    for(auto& result : results) {
+        total += result.acquisitions;
+        most = std::max(most, result.acquisitions);
+        least = least < 0 ? result.acquisitions : std::min(least, result.acquisitions);
+        waits.insert(waits.end(), result.wait_ns.begin(), result.wait_ns.end());
+    }
+    std::sort(waits.begin(), waits.end());
+    double fairness = least > 0 ? static_cast<double>(most) / least : 0;
+    std::cout << "{\"lock\":\"" << name << "\""
+              << ",\"threads\":" << thread_count
+              << ",\"acquisitions\":" << total
+              << ",\"seconds\":" << elapsed.count()
+              << ",\"acquisitions_per_sec\":" << static_cast<long long>(total / elapsed.count())
+              << ",\"wait_p50_ns\":" << Percentile(waits, 0.5)
+              << ",\"wait_p99_ns\":" << Percentile(waits, 0.99)
+              << ",\"wait_p999_ns\":" << Percentile(waits, 0.999)
+              << ",\"fairness\":" << fairness
+              << ",\"lost_updates\":" << total - shared_counter
+              << ",\"checksum\":" << (shared_state & 0xffff)
+              << "}" << std::endl;
+}
+
+void RunLocks(const BenchConfig& config, int thread_count) {
+    bool all = config.lock == "all";
+    if(all || config.lock == "tas") {
+        RunOne<TasSpinlock>("tas", thread_count, config.millis);
+    }
+    if(all || config.lock == "ttas") {
+        RunOne<TtasSpinlock>("ttas", thread_count, config.millis);
+    }
+    if(all || config.lock == "ticket") {
+        RunOne<TicketSpinlock>("ticket", thread_count, config.millis);
+    }
+    if(all || config.lock == "mcs") {
+        RunOne<McsSpinlock>("mcs", thread_count, config.millis);
+    }
+}
+
+void PrintUsage(const char* prog) {
+    std::cerr << "usage: " << prog << " [--lock=tas|ttas|ticket|mcs|all] [--threads=N] [--millis=N]" << std::endl;
+}
+
+bool IsKnownLock(const std::string& lock) {
+    for(const char* name : {"tas", "ttas", "ticket", "mcs", "all"}) {
+        if(lock == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseArg(const char* arg, BenchConfig& config) {
+    const char* eq = std::strchr(arg, '=');
+    if(std::strncmp(arg, "--", 2) != 0 || eq == nullptr) {
+        return false;
+    }
+    std::string key(arg + 2, eq);
+    const char* value = eq + 1;
+    if(key == "lock") {
+        // 拼错的锁名不能悄悄什么都不跑
+        if(!IsKnownLock(value)) {
+            std::cerr << "unknown lock: " << value << std::endl;
+            return false;
+        }
+        config.lock = value;
+    } else if(key == "threads") {
+        config.threads = std::atoi(value);
+    } else if(key == "millis") {
+        config.millis = std::atoi(value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    for(int i = 1; i < argc; ++i) {
+        if(!ParseArg(argv[i], config)) {
+            std::cerr << "unknown argument: " << argv[i] << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if(config.threads < 0 || config.millis <= 0) {
+        std::cerr << "threads and millis must be positive" << std::endl;
+        return 1;
+    }
+    if(config.threads > 0) {
+        RunLocks(config, config.threads);
+        return 0;
+    }
+    for(int thread_count : {1, 2, 4, 8}) {
+        RunLocks(config, thread_count);
+    }
+}
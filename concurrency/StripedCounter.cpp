@@ -0,0 +1,104 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "striped_counter.h"
+
+// 分条计数器代替chapter4_1.cpp中用recursive_mutex保护的Counter
+// 多个线程同时累加同一个计数器，比较三种实现的耗时：
+// recursive_mutex(increment中重入一次)、单个std::atomic、StripedCounter
+
+static const int kThreadCount = 4;
+static const int kIncrementsPerThread = 1000000;
+
+class Counter {
+public:
+    Counter() : count(0) {}
+    int add(int val) {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        count += val;
+        return count;
+    }
+    int increment() {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        return add(1);
+    }
+private:
+    std::recursive_mutex mutex;
+    int count;
+};
+
+template<typename F>
+void run(const char* name, F increment) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for(int t = 0; t < kThreadCount; ++t) {
+        threads.emplace_back([&increment] {
+            for(int i = 0; i < kIncrementsPerThread; ++i) {
+                increment();
+            }
+        });
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << elapsed.count() / (kThreadCount * kIncrementsPerThread) << " ns/increment, ";
+}
+
+void test1() {
+    Counter counter;
+    run("recursive_mutex Counter", [&counter] { counter.increment(); });
+    std::cout << "count = " << counter.add(0) << std::endl;
+
+    std::atomic<long long> atomic_counter(0);
+    run("std::atomic", [&atomic_counter] { atomic_counter.fetch_add(1, std::memory_order_relaxed); });
+    std::cout << "count = " << atomic_counter << std::endl;
+
+    StripedCounter striped;
+    run("StripedCounter", [&striped] { striped.Increment(); });
+    std::cout << "count = " << striped.ReadExact() << " (" << striped.StripeCount() << " stripes)" << std::endl;
+}
+
+// 写入进行中读取：近似读取只读一遍，精确读取要读到两遍一致为止，重试几次仍不一致就冻结所有条带再读
+void test2() {
+    StripedCounter requests;
+    std::atomic<bool> done(false);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < kThreadCount; ++t) {
+        threads.emplace_back([&requests] {
+            for(int i = 0; i < kIncrementsPerThread; ++i) {
+                requests.Increment();
+            }
+        });
+    }
+    std::thread reader([&requests, &done] {
+        int64_t last = 0;
+        int reads = 0;
+        bool monotonic = true;
+        while(!done.load()) {
+            int64_t value = requests.ReadExact();
+            if(value < last) {
+                monotonic = false;
+            }
+            last = value;
+            ++reads;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::cout << "exact reads during writes: " << reads << (monotonic ? ", never went backwards" : ", went backwards")
+                  << std::endl;
+    });
+    for(auto& th : threads) {
+        th.join();
+    }
+    done = true;
+    reader.join();
+    std::cout << "approximate = " << requests.ReadApproximate() << ", exact = " << requests.ReadExact() << std::endl;
+}
+
+int main() {
+    test1();
+    test2();
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "thread_pool.h"
+
+// 线程池代替每个任务创建一个线程
+// chapter3.cpp中的thread_task每次都新建一个std::thread，任务很短时，创建线程的开销占了大头。
+// 这里同样的短任务分别用"每个任务一个线程"和线程池执行，比较耗时。
+
+static const int kTaskCount = 20000;
+
+std::atomic<long long> gTaskSum(0);
+
+void short_task(int n) {
+    gTaskSum.fetch_add(n, std::memory_order_relaxed);
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void test1() {
+    gTaskSum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 1; i <= kTaskCount; ++i) {
+        std::thread th(short_task, i);
+        th.join();
+    }
+    std::cout << "thread per task: sum = " << gTaskSum << ", " << elapsed_ms(start) << " ms" << std::endl;
+
+    gTaskSum = 0;
+    start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(4);
+        for(int i = 1; i <= kTaskCount; ++i) {
+            pool.submit(short_task, i);
+        }
+        // 线程池析构时执行完所有已提交的任务
+    }
+    std::cout << "thread pool:     sum = " << gTaskSum << ", " << elapsed_ms(start) << " ms" << std::endl;
+}
+
+// submit返回future，可以取回结果，任务抛出的异常在get()时重新抛出
+void test2() {
+    ThreadPool pool(2);
+    std::future<int> square = pool.submit([](int x) { return x * x; }, 12);
+    std::future<void> failed = pool.submit([] { throw std::runtime_error("task failed"); });
+    std::cout << "square = " << square.get() << std::endl;
+    try {
+        failed.get();
+    } catch(const std::exception& e) {
+        std::cout << "caught: " << e.what() << std::endl;
+    }
+}
+
+// parallel_for：外层按行并行，每一行内部再嵌套parallel_for，等待时调用线程帮忙执行任务，不会死锁
+void test3() {
+    ThreadPool pool;
+    const int rows = 64;
+    const int cols = 4096;
+    std::vector<double> table(rows * cols);
+    parallel_for(pool, 0, rows, [&](int r) {
+        parallel_for(pool, 0, cols, [&](int c) {
+            table[r * cols + c] = std::sin(r * 0.01 + c * 0.001);
+        });
+    });
+    double sum = 0;
+    for(double v : table) {
+        sum += v;
+    }
+    double expect = 0;
+    for(int r = 0; r < rows; ++r) {
+        for(int c = 0; c < cols; ++c) {
+            expect += std::sin(r * 0.01 + c * 0.001);
+        }
+    }
+    std::cout << "parallel_for: " << (sum == expect ? "ok" : "mismatch") << std::endl;
+}
+
+int main() {
+    test1();
+    test2();
+    test3();
+}
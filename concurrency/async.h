@@ -0,0 +1,42 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "light_future.h"
+
+/*
+在执行器上运行的async
+
+chapter6_2.cpp的countdown和chapter6_3.cpp的ThreadTask用std::async(std::launch::async, ...)启动，
+每次调用都创建一个新的操作系统线程。负载高时同时存在的线程数没有上限，
+线程创建失败(std::system_error)或者调度延迟陡增。
+async_on(executor, f, args...)和std::async一样返回保存结果的future(LightFuture，见light_future.h)，
+但在给定的执行器上运行f(args...)，线程数由执行器决定：
+- ThreadPool(thread_pool.h)等提供execute(f)的执行器: 交给执行器，线程数是固定的。
+- InlineExecutor: 在调用线程中立即执行，返回已就绪的future，适合比提交本身还便宜的小任务。
+- DeferredExecutor: 和std::launch::deferred相同，第一次wait()/get()时在等待的线程中执行，
+  结果从未被用到时就不执行。
+参数和std::async一样按值拷贝(或移动)保存，f抛出的异常在get()时重新抛出。
+*/
+struct DeferredExecutor {};
+
+template<typename Executor, typename F, typename... Args>
+auto async_on(Executor&& executor, F&& f, Args&&... args)
+    -> LightFuture<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+    using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+    auto bound = [f = std::forward<F>(f), tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable -> R {
+        return std::apply(std::move(f), std::move(tuple));
+    };
+    if constexpr(std::is_same<std::decay_t<Executor>, DeferredExecutor>::value) {
+        return make_deferred_future(std::move(bound));
+    } else {
+        LightPackagedTask<R()> task(std::move(bound));
+        LightFuture<R> result = task.get_future();
+        executor.execute(std::move(task));
+        return result;
+    }
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+#include "spsc_item_repository.h"
+
+/*
+异步、低竞争的日志
+
+ProducerAndComsumer*.cpp、chapter*.cpp中的线程都直接写std::cout：
+所有线程在流的锁上串行，并且std::endl每一行都要做一次write系统调用。
+AsyncLogger把格式化和输出分开：
+1. 每个线程第一次写日志时向logger登记一个自己的缓冲区(SpscItemRepository，
+   本线程是唯一的生产者，后台线程是唯一的消费者)，之后写日志只在自己的缓冲区上操作，线程之间没有任何共享的锁。
+2. 日志直接用snprintf格式化进缓冲区的槽位(LogRecord)，不分配内存。
+   缓冲区满时丢弃这一行并计数，写日志的线程永远不会阻塞。
+3. 后台线程轮询所有缓冲区，把取出的日志拼成一大块，一次write系统调用输出。
+   没有日志时睡眠flush_interval，写日志的线程不需要唤醒它，热路径上也就没有栅栏和系统调用。
+
+同一个线程的日志按写入顺序输出；不同线程之间的日志顺序不保证，需要时可以在内容中带上时间戳。
+超过kLogLineSize - 1字节的日志会被截断。
+线程退出后它的缓冲区仍由logger持有，后台线程取完其中剩余的日志后将其释放。
+*/
+static const std::size_t kLogLineSize = 256;        // 一条日志记录的大小，决定一行日志的最大长度
+static const std::size_t kLogBufferCapacity = 1024; // 每个线程缓冲的日志行数
+
+struct LogRecord {
+    LogRecord() = default;
+    template<typename... Args>
+    LogRecord(const char* format, Args... args) {
+        static_assert(((std::is_arithmetic<Args>::value || std::is_pointer<Args>::value) && ...),
+                      "log arguments must be printf-compatible (use .c_str() for strings)");
+        int n = std::snprintf(text, sizeof(text), format, args...);
+        if(n < 0) {
+            n = 0;
+        }
+        length = n < static_cast<int>(sizeof(text)) ? static_cast<uint16_t>(n)
+                                                    : static_cast<uint16_t>(sizeof(text) - 1);
+    }
+
+    uint16_t length = 0;
+    char text[kLogLineSize - sizeof(uint16_t)];
+};
+
+class AsyncLogger {
+public:
+    using Buffer = SpscItemRepository<LogRecord, kLogBufferCapacity, BusySpinWait>;
+
+    explicit AsyncLogger(int fd = STDOUT_FILENO,
+                         std::chrono::microseconds flush_interval = std::chrono::microseconds(1000))
+        : fd(fd), flush_interval(flush_interval), id(NextLoggerId()), flusher(&AsyncLogger::FlushLoop, this) {}
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+    // 输出所有剩余的日志后结束后台线程
+    ~AsyncLogger() {
+        stopping.store(true, std::memory_order_release);
+        flusher.join();
+    }
+
+    // 按printf格式写一行日志(自动加换行)，缓冲区满时丢弃并返回false
+    template<typename... Args>
+    bool Log(const char* format, Args... args) {
+        if(TryEmplaceItem(ThisThreadBuffer().buffer, format, args...)) {
+            return true;
+        }
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 因为缓冲区满而丢弃的日志行数
+    std::size_t DroppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct ThreadBuffer {
+        Buffer buffer;
+        // 写日志的线程退出时置为false
+        std::atomic<bool> alive{true};
+    };
+
+    // 线程退出时标记自己的缓冲区。缓冲区由线程和logger共同持有，哪一方先结束都不会访问已释放的内存
+    struct ThreadBufferHandle {
+        std::shared_ptr<ThreadBuffer> buffer;
+        uint64_t logger_id = 0;
+        ~ThreadBufferHandle() {
+            if(buffer) {
+                buffer->alive.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    // 用递增的编号而不是地址识别logger，新logger复用了旧logger的地址也不会用错缓冲区
+    static uint64_t NextLoggerId() {
+        static std::atomic<uint64_t> next_id(1);
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*
+    本线程在这个logger上的缓冲区。每个线程最多缓存kLoggerCacheSize个logger的登记，按logger编号查找，
+    在几个logger之间交替写日志时一直复用各自的缓冲区，不会重新登记(分配内存、锁buffers_mtx)。
+    只有同时使用更多logger时才会轮流替换：被替换的缓冲区标记为结束，由后台线程取完后释放。
+    */
+    ThreadBuffer& ThisThreadBuffer() {
+        static const int kLoggerCacheSize = 4;
+        thread_local ThreadBufferHandle cache[kLoggerCacheSize];
+        thread_local int victim = 0;
+        for(ThreadBufferHandle& handle : cache) {
+            if(handle.logger_id == id) {
+                return *handle.buffer;
+            }
+        }
+        ThreadBufferHandle& handle = cache[victim];
+        victim = (victim + 1) % kLoggerCacheSize;
+        if(handle.buffer) {
+            handle.buffer->alive.store(false, std::memory_order_release);
+        }
+        handle.buffer = std::make_shared<ThreadBuffer>();
+        handle.logger_id = id;
+        std::lock_guard<std::mutex> lock(buffers_mtx);
+        buffers.push_back(handle.buffer);
+        return *handle.buffer;
+    }
+
+    // 取出所有缓冲区中的日志并一次写出，返回取出的行数
+    std::size_t FlushOnce(std::vector<char>& batch) {
+        std::size_t lines = 0;
+        std::unique_lock<std::mutex> lock(buffers_mtx);
+        for(std::size_t i = 0; i < buffers.size();) {
+            ThreadBuffer& tb = *buffers[i];
+            // 先读alive再取日志，线程退出前写的日志一定会在这一轮被取完
+            bool alive = tb.alive.load(std::memory_order_acquire);
+            // 直接在槽位上读取，不拷贝LogRecord
+            while(SpscHasItem(tb.buffer)) {
+                std::size_t rpos = tb.buffer.read_position.load(std::memory_order_relaxed);
+                const LogRecord& record = tb.buffer.item_buffer[rpos & Buffer::kMask].Get();
+                batch.insert(batch.end(), record.text, record.text + record.length);
+                batch.push_back('\n');
+                tb.buffer.item_buffer[rpos & Buffer::kMask].Destroy();
+                tb.buffer.read_position.store(rpos + 1, std::memory_order_release);
+                ++lines;
+            }
+            if(!alive) {
+                buffers.erase(buffers.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+        lock.unlock();
+        std::size_t written = 0;
+        while(written < batch.size()) {
+            ssize_t n = write(fd, batch.data() + written, batch.size() - written);
+            if(n <= 0) {
+                break;
+            }
+            written += static_cast<std::size_t>(n);
+        }
+        batch.clear();
+        return lines;
+    }
+
+    void FlushLoop() {
+        std::vector<char> batch;
+        batch.reserve(kLogLineSize * kLogBufferCapacity);
+        while(!stopping.load(std::memory_order_acquire)) {
+            if(FlushOnce(batch) == 0) {
+                std::this_thread::sleep_for(flush_interval);
+            }
+        }
+        FlushOnce(batch);
+    }
+
+    const int fd;
+    const std::chrono::microseconds flush_interval;
+    const uint64_t id;
+    std::mutex buffers_mtx; // 只在登记缓冲区和后台线程扫描时使用，写日志的热路径上不会用到
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::atomic<bool> stopping{false};
+    alignas(kCacheLineSize) std::atomic<std::size_t> dropped{0};
+    std::thread flusher;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "cache_line.h"
+#include "wait_strategy.h"
+
+/*
+一次性的闩(latch)和可重复使用的屏障(barrier)
+
+chapter5_1.cpp的go()用condition_variable的notify_all放行所有线程，被唤醒的线程还要依次抢同一个互斥量；
+chapter7_1.cpp的count1m在ready上yield轮询。迭代式的并行计算每一轮都要同步一次，
+屏障的开销直接落在关键路径上。这里的同步原语都以等待策略(wait_strategy.h)为模板参数：
+SpinYieldWait/BusySpinWait纯自旋，SpinThenParkWait先自旋再睡眠，BlockingWait直接睡眠。
+
+- Latch: 计数减到0时放行所有等待者，只能使用一次，适合作为"发令枪"或者等待一组任务完成。
+- CentralBarrier: 集中式的屏障。所有线程在同一个计数器上减一，最后到达的线程把计数器复位，
+  再把phase加一放行其他线程；等待者只读phase，因此可以反复使用，不需要额外的复位步骤。
+  每一轮所有线程都要写同一个cache line，线程多时这个计数器会成为热点。
+- DisseminationBarrier: 分发式(dissemination)屏障。共ceil(log2(n))轮，第k轮线程i通知线程(i+2^k)%n，
+  再等待线程(i-2^k)%n的通知。每个线程只在自己的标志上等待，每个标志只有一个写者，
+  没有全局的热点，关键路径长度是log2(n)次cache line传递。调用时要给出线程在[0, n)中的编号。
+  标志是单调递增的计数，线程i在第e次同步时等待标志达到e，因此也不需要复位。
+*/
+template<typename WaitStrategy = SpinThenParkWait>
+class Latch {
+public:
+    explicit Latch(std::ptrdiff_t expected) : count(expected) {}
+    Latch(const Latch&) = delete;
+    Latch& operator=(const Latch&) = delete;
+
+    void count_down(std::ptrdiff_t n = 1) {
+        if(count.fetch_sub(n, std::memory_order_acq_rel) == n) {
+            WaitStrategy::NotifyAll(released);
+        }
+    }
+
+    bool try_wait() const {
+        return count.load(std::memory_order_acquire) == 0;
+    }
+
+    void wait() {
+        WaitStrategy::WaitFor(released, [this] { return try_wait(); });
+    }
+
+    void arrive_and_wait(std::ptrdiff_t n = 1) {
+        count_down(n);
+        wait();
+    }
+
+private:
+    alignas(kCacheLineSize) std::atomic<std::ptrdiff_t> count;
+    typename WaitStrategy::WaitPoint released;
+};
+
+template<typename WaitStrategy = SpinThenParkWait>
+class CentralBarrier {
+public:
+    explicit CentralBarrier(uint32_t participants) : participants(participants), remaining(participants) {}
+    CentralBarrier(const CentralBarrier&) = delete;
+    CentralBarrier& operator=(const CentralBarrier&) = delete;
+
+    void arrive_and_wait() {
+        // 在本线程到达之前，这一轮不可能结束，因此这里读到的一定是当前这一轮
+        uint32_t current = phase.load(std::memory_order_acquire);
+        if(remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // 最后一个到达：先复位计数，再进入下一轮
+            remaining.store(participants, std::memory_order_relaxed);
+            phase.store(current + 1, std::memory_order_release);
+            WaitStrategy::NotifyAll(advanced);
+            return;
+        }
+        WaitStrategy::WaitFor(advanced, [this, current] {
+            return phase.load(std::memory_order_acquire) != current;
+        });
+    }
+
+private:
+    const uint32_t participants;
+    alignas(kCacheLineSize) std::atomic<uint32_t> remaining;
+    alignas(kCacheLineSize) std::atomic<uint32_t> phase{0};
+    typename WaitStrategy::WaitPoint advanced;
+};
+
+template<typename WaitStrategy = SpinThenParkWait>
+class DisseminationBarrier {
+public:
+    explicit DisseminationBarrier(std::size_t participants)
+        : participants(participants), rounds(Log2Ceil(participants)),
+          flags(new Flag[participants * rounds]), epochs(new Epoch[participants]) {}
+    DisseminationBarrier(const DisseminationBarrier&) = delete;
+    DisseminationBarrier& operator=(const DisseminationBarrier&) = delete;
+
+    // id是调用线程在[0, participants)中的编号，每个编号同一时刻只能由一个线程使用
+    void arrive_and_wait(std::size_t id) {
+        uint32_t epoch = ++epochs[id].value;
+        for(std::size_t k = 0; k < rounds; ++k) {
+            Flag& partner = flags[((id + (std::size_t(1) << k)) % participants) * rounds + k];
+            partner.count.fetch_add(1, std::memory_order_release);
+            WaitStrategy::Notify(partner.arrived);
+
+            Flag& mine = flags[id * rounds + k];
+            // 计数是累加的，同伴可能已经为下一轮递增过，因此比较的是"不小于"
+            WaitStrategy::WaitFor(mine.arrived, [&mine, epoch] {
+                return static_cast<int32_t>(mine.count.load(std::memory_order_acquire) - epoch) >= 0;
+            });
+        }
+    }
+
+    std::size_t size() const {
+        return participants;
+    }
+
+private:
+    struct alignas(kCacheLineSize) Flag {
+        std::atomic<uint32_t> count{0};
+        typename WaitStrategy::WaitPoint arrived;
+    };
+    // 每个线程已经完成的同步次数，只有该线程自己读写
+    struct alignas(kCacheLineSize) Epoch {
+        uint32_t value = 0;
+    };
+
+    static std::size_t Log2Ceil(std::size_t n) {
+        std::size_t rounds = 0;
+        while((std::size_t(1) << rounds) < n) {
+            ++rounds;
+        }
+        return rounds;
+    }
+
+    const std::size_t participants;
+    const std::size_t rounds;
+    std::unique_ptr<Flag[]> flags;
+    std::unique_ptr<Epoch[]> epochs;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef BATCH_FACTORIZER_H
+#define BATCH_FACTORIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "factorizer.h"
+#include "thread_pool.h"
+
+/*
+批量分解：result[i] = Factorize(values[i])
+
+各个数的分解互不依赖，用parallel_for按grain个数一块分给线程池。
+随机的64位数大多在试除阶段就分解完了，而两个32位素数之积要做上万次rho迭代，
+单个数的耗时相差几个数量级，块不能太大，否则一块里碰上几个难分解的数就会拖住整批，
+由空闲线程窃取剩下的块来平衡负载。
+*/
+inline std::vector<std::vector<uint64_t>> FactorizeBatch(ThreadPool& pool, const std::vector<uint64_t>& values,
+                                                         std::size_t grain = 64) {
+    std::vector<std::vector<uint64_t>> result(values.size());
+    parallel_for(pool, std::size_t(0), values.size(), [&](std::size_t i) {
+        result[i] = Factorize(values[i]);
+    }, grain);
+    return result;
+}
+
+#endif
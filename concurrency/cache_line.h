@@ -0,0 +1,14 @@
+#ifndef CACHE_LINE_H
+#define CACHE_LINE_H
+
+#include <cstddef>
+
+/*
+cache line大小，x86-64和大多数ARM64处理器都是64字节。
+被不同线程频繁写入的变量应当用alignas(kCacheLineSize)分开放置，
+否则它们落在同一个cache line上，会因为伪共享(false sharing)而互相拖慢。
+(C++17的std::hardware_destructive_interference_size在GCC中会产生ABI警告，这里直接写常量)
+*/
+static const std::size_t kCacheLineSize = 64;
+
+#endif
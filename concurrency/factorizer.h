@@ -0,0 +1,260 @@
+#ifndef FACTORIZER_H
+#define FACTORIZER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+/*
+64位整数的质因数分解
+
+item10.cpp中的primeFactors只有一个空的函数体。Factorize(n)按从小到大的顺序返回n的全部质因子(含重复)，
+0和1没有质因子，返回空。分三步：
+1. 小素数试除：先用ctz去掉所有的2，再试除1024以内的奇素数。
+   试除不用除法：对奇数p预先算好它模2^64的逆元inv，n能被p整除当且仅当n*inv <= UINT64_MAX/p，
+   此时n*inv就是商。剩下的数没有1024以内的因子，小于1024^2时它本身就是素数。
+2. 确定性的Miller-Rabin：用Jim Sinclair的7个底数，对所有64位整数都不会误判。
+3. Pollard-Brent rho：对合数找一个非平凡因子，再对两部分递归分解。
+   迭代x -> x^2 + c，每128步才做一次gcd(把|x-y|连乘起来)，gcd退化为n时回退逐步重算，
+   仍然失败就换一个c。
+Miller-Rabin和rho中的模乘都用Montgomery乘法：把数变换到Montgomery形式后，
+模n的乘法只需要两次64x64->128位乘法和一次减法，不需要128位的除法。
+批量并行的接口见batch_factorizer.h。
+*/
+namespace factorizer_detail {
+
+using u128 = unsigned __int128;
+
+// 奇数模n的Montgomery算术，R = 2^64
+class Montgomery {
+public:
+    explicit Montgomery(uint64_t n) : n(n) {
+        // 牛顿迭代求n模2^64的逆元，每一轮正确的位数翻倍(奇数n满足n*n ≡ 1 mod 8，初值有3位正确)
+        inverse = n;
+        for(int i = 0; i < 5; ++i) {
+            inverse *= 2 - n * inverse;
+        }
+        uint64_t r = (0 - n) % n; // 2^64 mod n
+        r2 = static_cast<uint64_t>(static_cast<u128>(r) * r % n);
+        one = Reduce(r2);
+    }
+
+    uint64_t modulus() const {
+        return n;
+    }
+    uint64_t One() const {
+        return one;
+    }
+
+    // 返回t/R mod n，要求t < n*R
+    uint64_t Reduce(u128 t) const {
+        uint64_t m = static_cast<uint64_t>(t) * inverse;
+        uint64_t mn_high = static_cast<uint64_t>((static_cast<u128>(m) * n) >> 64);
+        uint64_t t_high = static_cast<uint64_t>(t >> 64);
+        uint64_t r = t_high - mn_high;
+        return t_high < mn_high ? r + n : r;
+    }
+
+    uint64_t To(uint64_t a) const {
+        return Mul(a % n, r2);
+    }
+    uint64_t From(uint64_t a) const {
+        return Reduce(a);
+    }
+    uint64_t Mul(uint64_t a, uint64_t b) const {
+        return Reduce(static_cast<u128>(a) * b);
+    }
+    uint64_t Add(uint64_t a, uint64_t b) const {
+        uint64_t s = a + b;
+        return s < a || s >= n ? s - n : s;
+    }
+    uint64_t Sub(uint64_t a, uint64_t b) const {
+        return a >= b ? a - b : a - b + n;
+    }
+    uint64_t Pow(uint64_t a, uint64_t e) const {
+        uint64_t result = one;
+        while(e) {
+            if(e & 1) {
+                result = Mul(result, a);
+            }
+            a = Mul(a, a);
+            e >>= 1;
+        }
+        return result;
+    }
+
+private:
+    uint64_t n;
+    uint64_t inverse; // n^-1 mod 2^64
+    uint64_t r2;      // R^2 mod n
+    uint64_t one;     // R mod n
+};
+
+static const uint32_t kSmallPrimeBound = 1024;
+
+struct SmallPrime {
+    uint64_t p;
+    uint64_t inverse; // p^-1 mod 2^64
+    uint64_t limit;   // UINT64_MAX / p
+};
+
+// 3到kSmallPrimeBound之间的奇素数
+inline const std::vector<SmallPrime>& SmallPrimes() {
+    static const std::vector<SmallPrime> table = [] {
+        std::vector<SmallPrime> primes;
+        std::vector<bool> composite(kSmallPrimeBound, false);
+        for(uint64_t i = 3; i < kSmallPrimeBound; i += 2) {
+            if(composite[i]) {
+                continue;
+            }
+            for(uint64_t j = i * i; j < kSmallPrimeBound; j += 2 * i) {
+                composite[j] = true;
+            }
+            uint64_t inverse = i;
+            for(int k = 0; k < 5; ++k) {
+                inverse *= 2 - i * inverse;
+            }
+            primes.push_back(SmallPrime{i, inverse, UINT64_MAX / i});
+        }
+        return primes;
+    }();
+    return table;
+}
+
+// n为奇数且n >= 3
+inline bool MillerRabin(uint64_t n) {
+    Montgomery mont(n);
+    uint64_t d = n - 1;
+    int s = __builtin_ctzll(d);
+    d >>= s;
+    uint64_t one = mont.One();
+    uint64_t minus_one = mont.Sub(0, one);
+    static const uint64_t kBases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+    for(uint64_t base : kBases) {
+        uint64_t a = base % n;
+        if(a == 0) {
+            continue;
+        }
+        uint64_t x = mont.Pow(mont.To(a), d);
+        if(x == one || x == minus_one) {
+            continue;
+        }
+        bool composite = true;
+        for(int i = 1; i < s; ++i) {
+            x = mont.Mul(x, x);
+            if(x == minus_one) {
+                composite = false;
+                break;
+            }
+        }
+        if(composite) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// n为奇合数，返回n的一个非平凡因子
+inline uint64_t PollardBrent(uint64_t n) {
+    Montgomery mont(n);
+    const uint64_t kBatch = 128;
+    for(uint64_t c = 1;; ++c) {
+        uint64_t cm = mont.To(c);
+        auto f = [&mont, cm](uint64_t x) { return mont.Add(mont.Mul(x, x), cm); };
+        auto diff = [](uint64_t a, uint64_t b) { return a > b ? a - b : b - a; };
+        uint64_t y = mont.To(2);
+        uint64_t x = y;
+        uint64_t ys = y;
+        uint64_t q = mont.One();
+        uint64_t g = 1;
+        for(uint64_t r = 1; g == 1; r *= 2) {
+            x = y;
+            for(uint64_t i = 0; i < r; ++i) {
+                y = f(y);
+            }
+            for(uint64_t k = 0; k < r && g == 1; k += kBatch) {
+                ys = y;
+                uint64_t steps = std::min(kBatch, r - k);
+                for(uint64_t i = 0; i < steps; ++i) {
+                    y = f(y);
+                    q = mont.Mul(q, diff(x, y));
+                }
+                // q是Montgomery形式，R与n互素，gcd不受影响
+                g = std::gcd(q, n);
+            }
+        }
+        if(g == n) {
+            // 一批里同时包含了所有因子，从这一批的开头逐步重算
+            do {
+                ys = f(ys);
+                g = std::gcd(diff(x, ys), n);
+            } while(g == 1);
+        }
+        if(g != n) {
+            return g;
+        }
+    }
+}
+
+// n没有kSmallPrimeBound以内的因子
+inline void FactorizeLarge(uint64_t n, std::vector<uint64_t>& factors) {
+    if(n == 1) {
+        return;
+    }
+    if(n < uint64_t(kSmallPrimeBound) * kSmallPrimeBound || MillerRabin(n)) {
+        factors.push_back(n);
+        return;
+    }
+    uint64_t d = PollardBrent(n);
+    FactorizeLarge(d, factors);
+    FactorizeLarge(n / d, factors);
+}
+
+} // namespace factorizer_detail
+
+inline bool IsPrime64(uint64_t n) {
+    using namespace factorizer_detail;
+    if(n < 2 || n % 2 == 0) {
+        return n == 2;
+    }
+    for(const SmallPrime& sp : SmallPrimes()) {
+        if(sp.p * sp.p > n) {
+            return true;
+        }
+        if(n * sp.inverse <= sp.limit) {
+            return n == sp.p;
+        }
+    }
+    return MillerRabin(n);
+}
+
+inline std::vector<uint64_t> Factorize(uint64_t n) {
+    using namespace factorizer_detail;
+    std::vector<uint64_t> factors;
+    if(n < 2) {
+        return factors;
+    }
+    int twos = __builtin_ctzll(n);
+    factors.assign(twos, 2);
+    n >>= twos;
+    for(const SmallPrime& sp : SmallPrimes()) {
+        if(sp.p * sp.p > n) {
+            break;
+        }
+        while(n * sp.inverse <= sp.limit) {
+            factors.push_back(sp.p);
+            n *= sp.inverse; // 整除时乘以逆元就是商
+        }
+    }
+    if(n != 1 && n < uint64_t(kSmallPrimeBound) * kSmallPrimeBound) {
+        factors.push_back(n);
+        return factors;
+    }
+    std::size_t small = factors.size();
+    FactorizeLarge(n, factors);
+    std::sort(factors.begin() + small, factors.end());
+    return factors;
+}
+
+#endif
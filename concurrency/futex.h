@@ -0,0 +1,40 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+futex(fast userspace mutex)是Linux提供的等待原语：
+1. futex_wait(addr, expected): 若*addr仍等于expected，则当前线程睡眠在addr上，
+   否则立即返回。比较和睡眠在内核中是原子的，因此不会丢失唤醒。
+2. futex_wake(addr, n): 唤醒最多n个睡眠在addr上的线程。
+
+与std::condition_variable不同，futex不需要配合互斥量，
+调用者可以自己记录是否有等待者，没有等待者时完全跳过futex_wake系统调用，
+因此适合做无锁结构"慢路径"上的等待原语。
+futex_wait可能被虚假唤醒，调用者需要在循环中重新检查条件。
+
+默认使用FUTEX_PRIVATE_FLAG，只在进程内有效，内核可以跳过查找共享映射的开销。
+futex字位于多个进程共享的内存(shm_open/mmap)中时，process_shared传true。
+*/
+inline void futex_wait(std::atomic<uint32_t>* addr, uint32_t expected, bool process_shared = false) {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                  "futex word must be 32 bits");
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), process_shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE,
+            expected, nullptr, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t>* addr, int count, bool process_shared = false) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), process_shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE,
+            count, nullptr, nullptr, 0);
+}
+
+inline void futex_wake_all(std::atomic<uint32_t>* addr, bool process_shared = false) {
+    futex_wake(addr, INT32_MAX, process_shared);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef FUTURE_COMBINATORS_H
+#define FUTURE_COMBINATORS_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "light_future.h"
+
+/*
+LightFuture的组合：when_all和when_any
+
+请求扇出/汇聚(fan-out/fan-in)的代码常常为每个子请求阻塞一个线程在get()上。
+when_all/when_any在每个输入future上登记一个回调(LightFuture::on_ready)，不占用任何线程：
+- when_all(futures): 所有输入都就绪后，返回的future得到这些(已就绪的)输入。
+- when_any(futures): 任意一个输入就绪后，返回的future得到它的下标和全部输入，其余输入可能还没有就绪。
+输入future被移交给返回的future，结果(包括异常)仍然通过各个输入的get()取出。
+配合then(executor, f)，汇聚之后的工作在输入全部(或任一)就绪的那一刻就被提交到executor上。
+
+回调可能在登记的过程中就被触发(输入已经就绪，或者在其他线程中刚好完成)，
+因此登记本身也占一个计数，全部登记完之后才可能设置结果，不会在还在遍历输入时把它们移走。
+when_any不撤销落选输入上的回调，它们之后触发时什么也不做；共享状态支持多个回调，
+因此在落选的输入上再调用then，续延仍然要等到该输入真正就绪才执行。
+*/
+template<typename T>
+LightFuture<std::vector<LightFuture<T>>> when_all(std::vector<LightFuture<T>> futures) {
+    struct Block {
+        std::vector<LightFuture<T>> futures;
+        LightPromise<std::vector<LightFuture<T>>> promise;
+        std::atomic<std::size_t> remaining;
+
+        void Arrive() {
+            if(remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                promise.set_value(std::move(futures));
+            }
+        }
+    };
+    std::size_t n = futures.size();
+    auto block = std::make_shared<Block>();
+    block->futures = std::move(futures);
+    block->remaining.store(n + 1, std::memory_order_relaxed);
+    LightFuture<std::vector<LightFuture<T>>> result = block->promise.get_future();
+    for(std::size_t i = 0; i < n; ++i) {
+        block->futures[i].on_ready([block] { block->Arrive(); });
+    }
+    block->Arrive();
+    return result;
+}
+
+template<typename T>
+struct WhenAnyResult {
+    std::size_t index; // 第一个就绪的输入的下标，没有输入时为npos
+    std::vector<LightFuture<T>> futures;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+};
+
+template<typename T>
+LightFuture<WhenAnyResult<T>> when_any(std::vector<LightFuture<T>> futures) {
+    struct Block {
+        std::vector<LightFuture<T>> futures;
+        LightPromise<WhenAnyResult<T>> promise;
+        std::atomic<std::size_t> winner{WhenAnyResult<T>::npos};
+        // 登记完成和第一个就绪的输入各占一个计数，两者都到了才设置结果
+        std::atomic<int> gate{2};
+
+        void Release() {
+            if(gate.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                promise.set_value(WhenAnyResult<T>{winner.load(std::memory_order_relaxed), std::move(futures)});
+            }
+        }
+    };
+    std::size_t n = futures.size();
+    auto block = std::make_shared<Block>();
+    block->futures = std::move(futures);
+    LightFuture<WhenAnyResult<T>> result = block->promise.get_future();
+    if(n == 0) {
+        block->promise.set_value(WhenAnyResult<T>{WhenAnyResult<T>::npos, {}});
+        return result;
+    }
+    for(std::size_t i = 0; i < n; ++i) {
+        block->futures[i].on_ready([block, i] {
+            std::size_t expected = WhenAnyResult<T>::npos;
+            if(block->winner.compare_exchange_strong(expected, i, std::memory_order_acq_rel)) {
+                block->Release();
+            }
+        });
+    }
+    block->Release();
+    return result;
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef HYBRID_MUTEX_H
+#define HYBRID_MUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "futex.h"
+#include "wait_strategy.h"
+
+/*
+先自旋、再睡眠的混合互斥量，带竞争统计
+
+chapter4_1.cpp的Counter这样临界区只有几条指令的场合，std::mutex一遇到竞争就可能让线程睡眠，
+而持有锁的线程往往几十纳秒后就会释放锁，一次上下文切换(几微秒)比整个临界区贵得多。
+HybridMutex满足Lockable要求(lock/unlock/try_lock)，可以直接用于std::lock_guard、std::unique_lock、
+std::condition_variable_any：
+1. 没有竞争时，lock是一次CAS，unlock是一次exchange，不进入内核。
+2. 有竞争时先自旋：每次失败后用pause等待的次数加倍(指数退避)，减少对锁所在cache line的争抢。
+3. 自旋kHybridSpinRounds轮仍然拿不到锁，才在futex上睡眠。
+   state为2表示"已上锁并且可能有等待者"，unlock只在这种情况下才进入内核唤醒一个等待者
+   (Ulrich Drepper, "Futexes Are Tricky"中的mutex2)。
+只有一个CPU核心时，持有锁的线程不在运行，自旋不可能等到锁，因此直接睡眠。
+
+统计信息在持有锁时更新(只有持有者会写)，因此不需要原子的读-改-写，
+没有竞争的lock只多一次普通的存储；只有发生竞争时才读取时钟统计等待时间。
+*/
+static const int kHybridSpinRounds = 8;    // 自旋轮数
+static const int kHybridMaxBackoff = 64;   // 每轮最多pause的次数
+
+struct MutexStats {
+    uint64_t acquisitions = 0;  // 获得锁的次数
+    uint64_t contended = 0;     // 第一次尝试没有拿到锁的次数
+    uint64_t parked = 0;        // 自旋后仍然要在futex上睡眠的次数
+    uint64_t wait_ns = 0;       // 发生竞争时等待锁的总时间
+};
+
+class HybridMutex {
+public:
+    HybridMutex() = default;
+    HybridMutex(const HybridMutex&) = delete;
+    HybridMutex& operator=(const HybridMutex&) = delete;
+
+    void lock() {
+        uint32_t expected = kUnlocked;
+        if(state.compare_exchange_strong(expected, kLocked, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            Record(false, false, 0);
+            return;
+        }
+        LockContended();
+    }
+
+    bool try_lock() {
+        uint32_t expected = kUnlocked;
+        if(state.compare_exchange_strong(expected, kLocked, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            Record(false, false, 0);
+            return true;
+        }
+        return false;
+    }
+
+    void unlock() {
+        if(state.exchange(kUnlocked, std::memory_order_release) == kContended) {
+            futex_wake(&state, 1);
+        }
+    }
+
+    // 读取统计信息，可以在任意线程调用，得到的是近似的快照
+    MutexStats stats() const {
+        MutexStats s;
+        s.acquisitions = acquisitions.load(std::memory_order_relaxed);
+        s.contended = contended.load(std::memory_order_relaxed);
+        s.parked = parked.load(std::memory_order_relaxed);
+        s.wait_ns = wait_ns.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    static const uint32_t kUnlocked = 0;
+    static const uint32_t kLocked = 1;
+    static const uint32_t kContended = 2; // 已上锁，可能有等待者
+
+    void LockContended() {
+        auto start = std::chrono::steady_clock::now();
+        static const bool kCanSpin = std::thread::hardware_concurrency() > 1;
+        if(kCanSpin) {
+            int backoff = 1;
+            for(int round = 0; round < kHybridSpinRounds; ++round) {
+                for(int i = 0; i < backoff; ++i) {
+                    CpuRelax();
+                }
+                if(backoff < kHybridMaxBackoff) {
+                    backoff <<= 1;
+                }
+                // 先读再CAS，锁被占用时不去抢cache line的独占权
+                uint32_t expected = kUnlocked;
+                if(state.load(std::memory_order_relaxed) == kUnlocked
+                        && state.compare_exchange_weak(expected, kLocked, std::memory_order_acquire,
+                                                       std::memory_order_relaxed)) {
+                    Record(true, false, ElapsedNs(start));
+                    return;
+                }
+            }
+        }
+        // 把state置为kContended再睡眠，拿到锁时state也是kContended，
+        // 因为无法知道是否还有其他等待者，unlock时要唤醒一次
+        while(state.exchange(kContended, std::memory_order_acquire) != kUnlocked) {
+            futex_wait(&state, kContended);
+        }
+        Record(true, true, ElapsedNs(start));
+    }
+
+    static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+
+    // 持有锁时调用，只有持有者会写这些计数器
+    void Record(bool was_contended, bool was_parked, uint64_t waited_ns) {
+        acquisitions.store(acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if(was_contended) {
+            contended.store(contended.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            wait_ns.store(wait_ns.load(std::memory_order_relaxed) + waited_ns, std::memory_order_relaxed);
+        }
+        if(was_parked) {
+            parked.store(parked.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint32_t> state{kUnlocked};
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> parked{0};
+    std::atomic<uint64_t> wait_ns{0};
+};
+
+/*
+可递归上锁的HybridMutex，对应std::recursive_mutex。
+同一个线程再次上锁只增加深度，不碰底层的互斥量；统计信息只记录真正获得底层互斥量的次数。
+*/
+class HybridRecursiveMutex {
+public:
+    HybridRecursiveMutex() = default;
+    HybridRecursiveMutex(const HybridRecursiveMutex&) = delete;
+    HybridRecursiveMutex& operator=(const HybridRecursiveMutex&) = delete;
+
+    void lock() {
+        std::thread::id self = std::this_thread::get_id();
+        if(owner.load(std::memory_order_relaxed) == self) {
+            ++depth;
+            return;
+        }
+        mutex.lock();
+        owner.store(self, std::memory_order_relaxed);
+        depth = 1;
+    }
+
+    bool try_lock() {
+        std::thread::id self = std::this_thread::get_id();
+        if(owner.load(std::memory_order_relaxed) == self) {
+            ++depth;
+            return true;
+        }
+        if(!mutex.try_lock()) {
+            return false;
+        }
+        owner.store(self, std::memory_order_relaxed);
+        depth = 1;
+        return true;
+    }
+
+    void unlock() {
+        if(--depth == 0) {
+            owner.store(std::thread::id(), std::memory_order_relaxed);
+            mutex.unlock();
+        }
+    }
+
+    MutexStats stats() const {
+        return mutex.stats();
+    }
+
+private:
+    HybridMutex mutex;
+    // 只有持有者会把owner设为自己，其他线程读到的一定不是自己的id，因此relaxed就够了
+    std::atomic<std::thread::id> owner{std::thread::id()};
+    unsigned depth = 0;
+};
+
+#endif
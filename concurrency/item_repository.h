@@ -0,0 +1,326 @@
+#ifndef ITEM_REPOSITORY_H
+#define ITEM_REPOSITORY_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include "item_slot.h"
+
+/*
+互斥量+条件变量版本的ItemRepository，与ProducerAndComsumer1~4.cpp中的实现相同，
+另外提供批量生产/消费接口：
+
+ProduceItem/ConsumeItem每搬运一个产品就要加锁、解锁、notify一次。
+ProduceItems/ConsumeItems在一次临界区内搬运尽可能多的产品，
+整批产品只notify一次，把加锁和唤醒的开销分摊到32~256个产品上。
+
+ItemRepository<T, Capacity>可以存放任意类型T(包括只能移动的类型)，
+容量Capacity会被向上取整为2的幂。
+EmplaceItem在槽位上原地构造产品，ConsumeItem把产品移动出来，产品不会被拷贝。
+read_position和write_position是单调递增的计数器，下标为position & kMask，
+write_position - read_position即为产品数，因此所有槽位都能用上。
+
+缓冲区满时的处理方式(OverflowPolicy)可以配置：
+1. kBlock: 阻塞生产者，直到有空闲槽位(默认，与原来的行为相同)。
+2. kDropNewest: 丢弃正在生产的产品，生产者立即返回。
+3. kOverwriteOldest: 析构缓冲区中最旧的产品，用它的槽位存放新产品。
+4. kBlockWithTimeout: 最多阻塞overflow_timeout，超时则放弃该产品并返回kTimeout。
+每种处理都有计数器，GetOverflowStats可以看到一共丢弃/覆盖/超时了多少产品。
+
+关闭与排空(close/drain)：
+CloseItemRepository之后，生产者的产品被拒绝(返回kClosed)，
+消费者继续取走剩余的产品，取完后ConsumeItem(ir, item)返回false，ConsumeItems返回0，
+表示产品流结束。这样生产者/消费者线程只需要在产品库上循环，
+不再需要ProducerAndComsumer4.cpp中那两个加锁的全局计数器来判断何时退出。
+*/
+enum class OverflowPolicy {
+    kBlock,
+    kDropNewest,
+    kOverwriteOldest,
+    kBlockWithTimeout,
+};
+
+struct OverflowStats {
+    std::size_t produced = 0;    // 放入缓冲区的产品数
+    std::size_t dropped = 0;     // kDropNewest丢弃的产品数
+    std::size_t overwritten = 0; // kOverwriteOldest覆盖的产品数
+    std::size_t timed_out = 0;   // kBlockWithTimeout超时的产品数
+};
+
+template<typename T, std::size_t Capacity = 1024>
+class ItemRepository {
+public:
+    static constexpr std::size_t kCapacity = RoundUpPowerOfTwo(Capacity);
+    static constexpr std::size_t kMask = kCapacity - 1;
+
+    ItemRepository() = default;
+    ItemRepository(const ItemRepository&) = delete;
+    ItemRepository& operator=(const ItemRepository&) = delete;
+    ~ItemRepository() {
+        // 析构没有被取走的产品
+        for(; read_position != write_position; ++read_position) {
+            item_buffer[read_position & kMask].Destroy();
+        }
+    }
+
+    // 产品缓冲区，配合read_position和write_position形成环形队列
+    ItemSlot<T> item_buffer[kCapacity];
+    // 消费者读取产品位置
+    std::size_t read_position = 0;
+    // 生产者写入产品位置
+    std::size_t write_position = 0;
+    // 互斥量，保护产品缓冲区
+    std::mutex mtx;
+    // 条件变量，指示产品缓冲区不为满
+    std::condition_variable repo_not_full;
+    // 条件变量，指示产品缓冲区不为空
+    std::condition_variable repo_not_empty;
+    // 缓冲区满时的处理方式
+    OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+    std::chrono::nanoseconds overflow_timeout{0};
+    // 溢出计数器，由mtx保护
+    OverflowStats overflow_stats;
+    // 产品库是否已关闭，由mtx保护
+    bool closed = false;
+};
+
+// 清空产品库，析构剩余的产品
+template<typename T, std::size_t C>
+void InitItemRepository(ItemRepository<T, C>& ir) {
+    std::lock_guard<std::mutex> lck(ir.mtx);
+    for(; ir.read_position != ir.write_position; ++ir.read_position) {
+        ir.item_buffer[ir.read_position & ir.kMask].Destroy();
+    }
+    ir.read_position = 0;
+    ir.write_position = 0;
+    ir.closed = false;
+}
+
+// 关闭产品库：之后的生产都被拒绝，消费者取完剩余产品后得到结束信号。
+// 唤醒所有等待中的生产者和消费者，让它们重新检查状态。
+template<typename T, std::size_t C>
+void CloseItemRepository(ItemRepository<T, C>& ir) {
+    {
+        std::lock_guard<std::mutex> lck(ir.mtx);
+        ir.closed = true;
+    }
+    ir.repo_not_full.notify_all();
+    ir.repo_not_empty.notify_all();
+}
+
+template<typename T, std::size_t C>
+void SetOverflowPolicy(ItemRepository<T, C>& ir, OverflowPolicy policy,
+                       std::chrono::nanoseconds timeout = std::chrono::nanoseconds(0)) {
+    std::lock_guard<std::mutex> lck(ir.mtx);
+    ir.overflow_policy = policy;
+    ir.overflow_timeout = timeout;
+}
+
+template<typename T, std::size_t C>
+OverflowStats GetOverflowStats(ItemRepository<T, C>& ir) {
+    std::lock_guard<std::mutex> lck(ir.mtx);
+    return ir.overflow_stats;
+}
+
+// 缓冲区中的产品数，调用者需持有ir.mtx
+template<typename T, std::size_t C>
+std::size_t ItemCount(const ItemRepository<T, C>& ir) {
+    return ir.write_position - ir.read_position;
+}
+
+// 缓冲区中的空闲槽位数，调用者需持有ir.mtx
+template<typename T, std::size_t C>
+std::size_t FreeSlotCount(const ItemRepository<T, C>& ir) {
+    return ir.kCapacity - ItemCount(ir);
+}
+
+// 按overflow_policy为一个新产品腾出槽位，调用者需持有ir.mtx(由lck锁住)。
+// 返回kOk或kOverwritten时可以写入产品，kDropped/kTimeout/kClosed时新产品被放弃。
+// deadline只在kBlockWithTimeout第一次需要等待时才计算，同一批产品共用一个截止时间，
+// 这样其他策略的热路径上不需要读取时钟。
+template<typename T, std::size_t C>
+ProduceStatus ReserveSlot(ItemRepository<T, C>& ir, std::unique_lock<std::mutex>& lck,
+                          std::chrono::steady_clock::time_point& deadline) {
+    if(ir.closed) {
+        return ProduceStatus::kClosed;
+    }
+    if(FreeSlotCount(ir) > 0) {
+        return ProduceStatus::kOk;
+    }
+    switch(ir.overflow_policy) {
+    case OverflowPolicy::kDropNewest:
+        ++ir.overflow_stats.dropped;
+        return ProduceStatus::kDropped;
+    case OverflowPolicy::kOverwriteOldest:
+        // 析构最旧的产品，腾出它的槽位
+        ir.item_buffer[ir.read_position & ir.kMask].Destroy();
+        ++ir.read_position;
+        ++ir.overflow_stats.overwritten;
+        return ProduceStatus::kOverwritten;
+    case OverflowPolicy::kBlockWithTimeout:
+        if(deadline == std::chrono::steady_clock::time_point()) {
+            deadline = std::chrono::steady_clock::now() + ir.overflow_timeout;
+        }
+        while(FreeSlotCount(ir) == 0 && !ir.closed) {
+            if(ir.repo_not_full.wait_until(lck, deadline) == std::cv_status::timeout
+                    && FreeSlotCount(ir) == 0 && !ir.closed) {
+                ++ir.overflow_stats.timed_out;
+                return ProduceStatus::kTimeout;
+            }
+        }
+        return ir.closed ? ProduceStatus::kClosed : ProduceStatus::kOk;
+    case OverflowPolicy::kBlock:
+    default:
+        while(FreeSlotCount(ir) == 0 && !ir.closed) {
+            // 生产者需要等待产品缓冲区不为满这一条件变量
+            ir.repo_not_full.wait(lck);
+        }
+        return ir.closed ? ProduceStatus::kClosed : ProduceStatus::kOk;
+    }
+}
+
+// 在槽位上用args原地构造产品，缓冲区满时按overflow_policy处理
+template<typename T, std::size_t C, typename... Args>
+ProduceStatus EmplaceItem(ItemRepository<T, C>& ir, Args&&... args) {
+    std::chrono::steady_clock::time_point deadline;
+    std::unique_lock<std::mutex> lck(ir.mtx);
+    ProduceStatus status = ReserveSlot(ir, lck, deadline);
+    if(status == ProduceStatus::kDropped || status == ProduceStatus::kTimeout
+            || status == ProduceStatus::kClosed) {
+        return status;
+    }
+    // 生产产品
+    ir.item_buffer[ir.write_position & ir.kMask].Emplace(std::forward<Args>(args)...);
+    ++ir.write_position;
+    ++ir.overflow_stats.produced;
+    lck.unlock();
+    // 通知消费者，产品库不为空
+    ir.repo_not_empty.notify_one();
+    return status;
+}
+
+template<typename T, std::size_t C, typename U>
+ProduceStatus ProduceItem(ItemRepository<T, C>& ir, U&& item) {
+    return EmplaceItem(ir, std::forward<U>(item));
+}
+
+// 取出一个产品，缓冲区空时阻塞。产品库关闭并且已经取完时返回false(产品流结束)
+template<typename T, std::size_t C>
+bool ConsumeItem(ItemRepository<T, C>& ir, T& item) {
+    std::unique_lock<std::mutex> lck(ir.mtx);
+    while(ItemCount(ir) == 0) {
+        if(ir.closed) {
+            return false;
+        }
+        // 消费者等待生产者生产产品
+        ir.repo_not_empty.wait(lck);
+    }
+    // 取出产品
+    item = ir.item_buffer[ir.read_position & ir.kMask].Take();
+    ++ir.read_position;
+    lck.unlock();
+    // 通知生产者产品库还可以继续生产产品
+    ir.repo_not_full.notify_one();
+    return true;
+}
+
+// 取出一个产品，缓冲区空时阻塞。不检查关闭状态，关闭后请使用ConsumeItem(ir, item)
+template<typename T, std::size_t C>
+T ConsumeItem(ItemRepository<T, C>& ir) {
+    std::unique_lock<std::mutex> lck(ir.mtx);
+    while(ItemCount(ir) == 0) {
+        // 消费者等待生产者生产产品
+        ir.repo_not_empty.wait(lck);
+    }
+    // 取出产品
+    T data = ir.item_buffer[ir.read_position & ir.kMask].Take();
+    ++ir.read_position;
+    lck.unlock();
+    // 通知生产者产品库还可以继续生产产品
+    ir.repo_not_full.notify_one();
+    return data;
+}
+
+// 批量生产count个产品(从items中移动)。每次拿到锁后写入当前能放下的所有产品，
+// 每写入一批只notify一次。缓冲区满时按overflow_policy处理：
+// kDropNewest丢弃放不下的产品，kOverwriteOldest覆盖最旧的产品，
+// kBlockWithTimeout超时后丢弃剩下的产品。产品库关闭后剩下的产品被拒绝。
+// 返回实际放入缓冲区的产品数。
+template<typename T, std::size_t C, typename U>
+std::size_t ProduceItems(ItemRepository<T, C>& ir, U* items, std::size_t count) {
+    std::chrono::steady_clock::time_point deadline;
+    std::size_t accepted = 0;
+    while(count > 0) {
+        std::unique_lock<std::mutex> lck(ir.mtx);
+        ProduceStatus status = ReserveSlot(ir, lck, deadline);
+        if(status == ProduceStatus::kClosed) {
+            break;
+        }
+        if(status == ProduceStatus::kDropped || status == ProduceStatus::kTimeout) {
+            // 剩下的产品都被放弃，第一个已经被ReserveSlot计数
+            std::size_t rest = count - 1;
+            if(status == ProduceStatus::kDropped) {
+                ir.overflow_stats.dropped += rest;
+            } else {
+                ir.overflow_stats.timed_out += rest;
+            }
+            break;
+        }
+        std::size_t n = FreeSlotCount(ir);
+        if(status == ProduceStatus::kOverwritten) {
+            // ReserveSlot只腾出了一个槽位，继续覆盖最旧的产品，直到整批(最多整个缓冲区)都能放下
+            std::size_t want = count < ir.kCapacity ? count : ir.kCapacity;
+            for(; n < want; ++n) {
+                ir.item_buffer[ir.read_position & ir.kMask].Destroy();
+                ++ir.read_position;
+                ++ir.overflow_stats.overwritten;
+            }
+        }
+        if(n > count) {
+            n = count;
+        }
+        for(std::size_t i = 0; i < n; ++i) {
+            ir.item_buffer[ir.write_position & ir.kMask].Emplace(std::move(items[i]));
+            ++ir.write_position;
+        }
+        ir.overflow_stats.produced += n;
+        lck.unlock();
+        // 一批产品可能够多个消费者取用
+        ir.repo_not_empty.notify_all();
+        items += n;
+        count -= n;
+        accepted += n;
+    }
+    return accepted;
+}
+
+// 批量消费，最多取出max个产品移动到out，返回实际取出的个数。
+// 缓冲区空时阻塞，直到至少有一个产品。产品库关闭并且已经取完时返回0。
+template<typename T, std::size_t C>
+std::size_t ConsumeItems(ItemRepository<T, C>& ir, T* out, std::size_t max) {
+    if(max == 0) {
+        return 0;
+    }
+    std::unique_lock<std::mutex> lck(ir.mtx);
+    while(ItemCount(ir) == 0) {
+        if(ir.closed) {
+            return 0;
+        }
+        ir.repo_not_empty.wait(lck);
+    }
+    std::size_t n = ItemCount(ir);
+    if(n > max) {
+        n = max;
+    }
+    for(std::size_t i = 0; i < n; ++i) {
+        out[i] = ir.item_buffer[ir.read_position & ir.kMask].Take();
+        ++ir.read_position;
+    }
+    lck.unlock();
+    ir.repo_not_full.notify_all();
+    return n;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef ITEM_SLOT_H
+#define ITEM_SLOT_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/*
+环形缓冲区的公共部件
+
+1. RoundUpPowerOfTwo: 把容量向上取整为2的幂，这样下标回绕可以用position & (capacity - 1)
+   代替position % capacity。
+2. ItemSlot<T>: 未初始化的槽位存储。生产者用Emplace在槽位上原地构造产品，
+   消费者用Take把产品移动出来并析构槽位中的对象。
+   因此T可以是std::unique_ptr这样只能移动的类型，大的产品也不会被拷贝，
+   T也不需要默认构造函数。
+   槽位本身不记录是否有对象，由所属的ItemRepository根据读写位置负责析构剩余的产品。
+3. ProduceStatus: 所有ItemRepository的ProduceItem/EmplaceItem都返回它，
+   因此可以互相替换的各个实现对调用方的接口完全相同。
+   无锁实现只会返回kOk或kClosed，其余取值只有互斥量版本的溢出策略会用到。
+*/
+constexpr std::size_t RoundUpPowerOfTwo(std::size_t n) {
+    std::size_t power = 1;
+    while(power < n) {
+        power <<= 1;
+    }
+    return power;
+}
+
+// 生产一个产品的结果
+enum class ProduceStatus {
+    kOk,          // 产品已放入缓冲区
+    kDropped,     // 缓冲区满，新产品被丢弃
+    kOverwritten, // 产品已放入缓冲区，但覆盖了最旧的产品
+    kTimeout,     // 等待空闲槽位超时，新产品被丢弃
+    kClosed,      // 产品库已关闭，新产品被拒绝
+};
+
+template<typename T>
+class ItemSlot {
+public:
+    template<typename... Args>
+    void Emplace(Args&&... args) {
+        ::new(static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+    T& Get() {
+        return *std::launder(reinterpret_cast<T*>(storage));
+    }
+    // 移出产品并析构槽位中的对象
+    T Take() {
+        T item(std::move(Get()));
+        Destroy();
+        return item;
+    }
+    void Destroy() {
+        Get().~T();
+    }
+private:
+    alignas(T) unsigned char storage[sizeof(T)];
+};
+
+#endif
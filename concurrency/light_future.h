@@ -0,0 +1,487 @@
+#ifndef LIGHT_FUTURE_H
+#define LIGHT_FUTURE_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "futex.h"
+
+/*
+轻量的一次性future/promise
+
+chapter6_1.cpp~chapter6_3.cpp中的std::promise/std::future/std::packaged_task，
+每个结果都要在堆上分配一个带互斥量和条件变量的共享状态，设置值和get()都要上锁。
+每秒要创建上百万个短命future时，这些开销占了大头。
+LightPromise/LightFuture的共享状态只有一次分配，同步只靠一个32位的状态字：
+1. 状态字的取值：kEmpty(还没有结果)、kWaiting(还没有结果，并且有线程在futex上等待)、
+   kValue/kError(结果已就绪)。
+2. 设置结果时先构造值，再用一次exchange把状态改为就绪；只有换出来的是kWaiting时才调用futex_wake。
+3. get()先读一次状态字(acquire)，已经就绪就直接取值，快路径上没有锁也没有系统调用；
+   否则把kEmpty改成kWaiting，再futex_wait，醒来后重新检查。
+共享状态由promise和future共同持有(引用计数为2)，后释放的一方负责销毁。
+
+续延(continuation)：future.then(executor, f)在结果就绪时把f(future)提交给executor执行，
+返回保存f结果的新future，等待结果的过程不占用任何线程。
+共享状态里另有一个回调字，它是回调链表(侵入式的无锁栈)的表头，登记回调和发布结果都对它做一次原子操作：
+发布时把表头换成kFired，按登记顺序执行换出来的所有回调；登记时看到kFired就立即执行，否则把回调压入链表。
+谁后到谁负责执行，因此不会出现回调登记晚了而错过结果的情况。
+同一个共享状态可以登记多个回调，例如when_any在每个输入上留下的回调，和之后在落选的输入上调用的then。executor是任何提供execute(f)的对象，
+例如ThreadPool(thread_pool.h)；InlineExecutor直接在设置结果的线程中执行。
+when_all/when_any见future_combinators.h。
+
+延迟执行：make_deferred_future(f)返回的future在第一次被wait()/get()或者登记续延时，
+才在调用线程中执行f，和std::launch::deferred相同；从未被等待就销毁时f不会执行。
+
+接口和std::promise/std::future一致(get_future只能调用一次，get()之后future失效，
+promise在设置结果之前析构时future得到broken_promise)，但不支持T为引用，也不提供shared_future。
+*/
+namespace light_future_detail {
+
+// void结果用一个空类型占位，共享状态不需要为void单独实现
+struct Unit {};
+
+template<typename T>
+using StoredType = std::conditional_t<std::is_void<T>::value, Unit, T>;
+
+static const uint32_t kEmpty = 0;
+static const uint32_t kWaiting = 1;
+static const uint32_t kValue = 2;
+static const uint32_t kError = 3;
+
+// 结果就绪时执行一次的回调，执行后自行销毁
+struct ReadyCallback {
+    virtual ~ReadyCallback() = default;
+    virtual void run() = 0;
+    ReadyCallback* next = nullptr; // 回调链表中较早登记的回调
+};
+
+template<typename F>
+struct ReadyCallbackImpl : ReadyCallback {
+    explicit ReadyCallbackImpl(F&& f) : f(std::move(f)) {}
+    void run() override {
+        f();
+    }
+    F f;
+};
+
+template<typename F>
+ReadyCallback* MakeReadyCallback(F&& f) {
+    return new ReadyCallbackImpl<std::decay_t<F>>(std::forward<F>(f));
+}
+
+// 回调字的取值：0(没有回调)、kFired(结果已发布)或者最后登记的回调的地址
+static const uintptr_t kFired = 1;
+
+// 调用f(args...)，把返回值或抛出的异常交给promise
+template<typename Promise, typename F, typename... Args>
+void SetResult(Promise& promise, F& f, Args&&... args) {
+    try {
+        if constexpr(std::is_void<std::invoke_result_t<F&, Args...>>::value) {
+            f(std::forward<Args>(args)...);
+            promise.set_value();
+        } else {
+            promise.set_value(f(std::forward<Args>(args)...));
+        }
+    } catch(...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+template<typename T>
+class SharedState {
+public:
+    using Value = StoredType<T>;
+
+    ~SharedState() {
+        if(status.load(std::memory_order_relaxed) == kValue) {
+            value().~Value();
+        }
+        uintptr_t cb = callback.load(std::memory_order_relaxed);
+        if(cb != kFired) {
+            for(ReadyCallback* p = reinterpret_cast<ReadyCallback*>(cb); p != nullptr;) {
+                delete std::exchange(p, p->next);
+            }
+        }
+        delete deferred.load(std::memory_order_relaxed);
+    }
+
+    bool ready() const {
+        return status.load(std::memory_order_acquire) >= kValue;
+    }
+    bool has_result() const {
+        return status.load(std::memory_order_relaxed) >= kValue;
+    }
+
+    template<typename... Args>
+    void set_value(Args&&... args) {
+        CheckNotSet();
+        new(storage) Value(std::forward<Args>(args)...);
+        Publish(kValue);
+    }
+
+    void set_exception(std::exception_ptr e) {
+        CheckNotSet();
+        error = std::move(e);
+        Publish(kError);
+    }
+
+    void wait() {
+        RunDeferred();
+        uint32_t s = status.load(std::memory_order_acquire);
+        while(s < kValue) {
+            if(s == kEmpty && !status.compare_exchange_weak(s, kWaiting, std::memory_order_acquire)) {
+                continue;
+            }
+            futex_wait(&status, kWaiting);
+            s = status.load(std::memory_order_acquire);
+        }
+    }
+
+    // 登记结果就绪时执行的回调，已经就绪就立即执行。可以登记多个，按登记顺序执行
+    void on_ready(ReadyCallback* cb) {
+        RunDeferred();
+        uintptr_t head = callback.load(std::memory_order_acquire);
+        while(1) {
+            if(head == kFired) {
+                Run(cb);
+                return;
+            }
+            cb->next = reinterpret_cast<ReadyCallback*>(head);
+            if(callback.compare_exchange_weak(head, reinterpret_cast<uintptr_t>(cb), std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+                return;
+            }
+        }
+    }
+
+    // 调用前结果必须已就绪
+    Value& value() {
+        if(status.load(std::memory_order_relaxed) == kError) {
+            std::rethrow_exception(error);
+        }
+        return *std::launder(reinterpret_cast<Value*>(storage));
+    }
+
+    // 设置延迟执行的任务，由它负责设置结果。必须在future交出去之前调用
+    void set_deferred(ReadyCallback* task) {
+        deferred.store(task, std::memory_order_relaxed);
+    }
+
+    // future不再需要结果时丢弃还没有执行的延迟任务，任务持有的promise随之释放
+    void discard_deferred() {
+        if(deferred.load(std::memory_order_relaxed) != nullptr) {
+            delete deferred.exchange(nullptr, std::memory_order_acq_rel);
+        }
+    }
+
+    void release() {
+        if(refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    // 只有promise一侧会设置结果，因此检查和设置之间不需要同步
+    bool retrieved = false;
+
+private:
+    void CheckNotSet() {
+        if(has_result()) {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+    }
+
+    void Publish(uint32_t result) {
+        if(status.exchange(result, std::memory_order_acq_rel) == kWaiting) {
+            futex_wake_all(&status);
+        }
+        // 链表是后进先出的，反转后按登记顺序执行
+        ReadyCallback* list = reinterpret_cast<ReadyCallback*>(callback.exchange(kFired, std::memory_order_acq_rel));
+        ReadyCallback* ordered = nullptr;
+        while(list != nullptr) {
+            ReadyCallback* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+        while(ordered != nullptr) {
+            Run(std::exchange(ordered, ordered->next));
+        }
+    }
+
+    static void Run(ReadyCallback* cb) {
+        std::unique_ptr<ReadyCallback> owner(cb);
+        cb->run();
+    }
+
+    void RunDeferred() {
+        if(deferred.load(std::memory_order_relaxed) != nullptr) {
+            ReadyCallback* task = deferred.exchange(nullptr, std::memory_order_acq_rel);
+            if(task != nullptr) {
+                Run(task);
+            }
+        }
+    }
+
+    std::atomic<uint32_t> status{kEmpty};
+    std::atomic<uint32_t> refs{2};
+    std::atomic<uintptr_t> callback{0};
+    std::atomic<ReadyCallback*> deferred{nullptr};
+    alignas(Value) unsigned char storage[sizeof(Value)];
+    std::exception_ptr error;
+};
+
+struct Access;
+
+} // namespace light_future_detail
+
+// 在调用execute的线程中直接执行
+struct InlineExecutor {
+    template<typename F>
+    void execute(F&& f) {
+        f();
+    }
+};
+
+template<typename T>
+class LightPromise;
+
+template<typename T>
+class LightFuture {
+public:
+    static_assert(!std::is_reference<T>::value, "LightFuture does not support reference results");
+
+    LightFuture() = default;
+    LightFuture(LightFuture&& other) noexcept : state(std::exchange(other.state, nullptr)) {}
+    LightFuture& operator=(LightFuture&& other) noexcept {
+        if(this != &other) {
+            reset();
+            state = std::exchange(other.state, nullptr);
+        }
+        return *this;
+    }
+    ~LightFuture() {
+        reset();
+    }
+
+    bool valid() const {
+        return state != nullptr;
+    }
+
+    // 结果是否已就绪，不会阻塞
+    bool is_ready() const {
+        CheckValid();
+        return state->ready();
+    }
+
+    void wait() const {
+        CheckValid();
+        state->wait();
+    }
+
+    // 等待并取出结果，之后future不再有效
+    T get() {
+        wait();
+        State* s = std::exchange(state, nullptr);
+        struct Release {
+            State* s;
+            ~Release() {
+                s->release();
+            }
+        } guard{s};
+        if constexpr(std::is_void<T>::value) {
+            s->value();
+        } else {
+            return std::move(s->value());
+        }
+    }
+
+    // 结果就绪后在executor上执行f(future)，返回保存f结果的future。
+    // 本future被移交给f，调用后不再有效；executor必须活到f执行完
+    template<typename Executor, typename F>
+    auto then(Executor& executor, F&& f) -> LightFuture<std::invoke_result_t<std::decay_t<F>, LightFuture<T>>> {
+        using R = std::invoke_result_t<std::decay_t<F>, LightFuture<T>>;
+        CheckValid();
+        State* s = state;
+        LightPromise<R> promise;
+        LightFuture<R> result = promise.get_future();
+        s->on_ready(light_future_detail::MakeReadyCallback(
+            [executor = &executor, f = std::forward<F>(f), self = std::move(*this),
+             promise = std::move(promise)]() mutable {
+                executor->execute([f = std::move(f), self = std::move(self), promise = std::move(promise)]() mutable {
+                    light_future_detail::SetResult(promise, f, std::move(self));
+                });
+            }));
+        return result;
+    }
+
+    // 在设置结果的线程中执行f，f应当很短
+    template<typename F>
+    auto then(F&& f) -> LightFuture<std::invoke_result_t<std::decay_t<F>, LightFuture<T>>> {
+        static InlineExecutor inline_executor;
+        return then(inline_executor, std::forward<F>(f));
+    }
+
+    // 结果就绪时执行callback()，不移交future，供when_all/when_any使用
+    template<typename F>
+    void on_ready(F&& callback) {
+        CheckValid();
+        state->on_ready(light_future_detail::MakeReadyCallback(std::forward<F>(callback)));
+    }
+
+private:
+    template<typename U>
+    friend class LightPromise;
+    friend struct light_future_detail::Access;
+    using State = light_future_detail::SharedState<T>;
+
+    explicit LightFuture(State* state) : state(state) {}
+
+    void CheckValid() const {
+        if(state == nullptr) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+    void reset() {
+        if(state != nullptr) {
+            state->discard_deferred();
+            std::exchange(state, nullptr)->release();
+        }
+    }
+
+    State* state = nullptr;
+};
+
+template<typename T>
+class LightPromise {
+public:
+    LightPromise() : state(new State) {}
+    LightPromise(LightPromise&& other) noexcept : state(std::exchange(other.state, nullptr)) {}
+    LightPromise& operator=(LightPromise&& other) noexcept {
+        if(this != &other) {
+            abandon();
+            state = std::exchange(other.state, nullptr);
+        }
+        return *this;
+    }
+    ~LightPromise() {
+        abandon();
+    }
+
+    LightFuture<T> get_future() {
+        CheckValid();
+        if(state->retrieved) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        state->retrieved = true;
+        return LightFuture<T>(state);
+    }
+
+    // T为void时不带参数，否则参数用来构造T
+    template<typename... Args>
+    void set_value(Args&&... args) {
+        CheckValid();
+        state->set_value(std::forward<Args>(args)...);
+    }
+
+    void set_exception(std::exception_ptr e) {
+        CheckValid();
+        state->set_exception(std::move(e));
+    }
+
+private:
+    using State = light_future_detail::SharedState<T>;
+
+    void CheckValid() const {
+        if(state == nullptr) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+    // 还没有设置结果就析构，future会得到broken_promise
+    void abandon() {
+        if(state == nullptr) {
+            return;
+        }
+        if(!state->has_result()) {
+            state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+        // 没有取过future时，future一侧的引用也由promise释放
+        if(!state->retrieved) {
+            state->release();
+        }
+        std::exchange(state, nullptr)->release();
+    }
+
+    State* state;
+};
+
+namespace light_future_detail {
+
+struct Access {
+    template<typename T>
+    static SharedState<T>* state(LightFuture<T>& future) {
+        return future.state;
+    }
+};
+
+} // namespace light_future_detail
+
+// 返回延迟执行f()的future，f在第一次等待结果的线程中执行
+template<typename F>
+auto make_deferred_future(F&& f) -> LightFuture<std::invoke_result_t<std::decay_t<F>&>> {
+    using R = std::invoke_result_t<std::decay_t<F>&>;
+    LightPromise<R> promise;
+    LightFuture<R> result = promise.get_future();
+    light_future_detail::Access::state(result)->set_deferred(light_future_detail::MakeReadyCallback(
+        [f = std::forward<F>(f), promise = std::move(promise)]() mutable {
+            light_future_detail::SetResult(promise, f);
+        }));
+    return result;
+}
+
+template<typename Signature>
+class LightPackagedTask;
+
+// 和std::packaged_task相同：调用时执行被包装的函数，把返回值或异常交给future
+template<typename R, typename... Args>
+class LightPackagedTask<R(Args...)> {
+public:
+    template<typename F>
+    explicit LightPackagedTask(F&& f) : fn(new Callable<std::decay_t<F>>(std::forward<F>(f))) {}
+
+    LightFuture<R> get_future() {
+        return promise.get_future();
+    }
+
+    void operator()(Args... args) {
+        light_future_detail::SetResult(promise, *fn, std::forward<Args>(args)...);
+    }
+
+private:
+    // 类型擦除的可调用对象，和std::function不同，可以保存只能移动的对象
+    struct CallableBase {
+        virtual ~CallableBase() = default;
+        virtual R call(Args... args) = 0;
+        R operator()(Args... args) {
+            return call(std::forward<Args>(args)...);
+        }
+    };
+    template<typename F>
+    struct Callable : CallableBase {
+        explicit Callable(F&& f) : f(std::move(f)) {}
+        explicit Callable(const F& f) : f(f) {}
+        R call(Args... args) override {
+            return f(std::forward<Args>(args)...);
+        }
+        F f;
+    };
+
+    std::unique_ptr<CallableBase> fn;
+    LightPromise<R> promise;
+};
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+锁竞争分析器
+
+ProfiledMutex<Mutex>包装任意互斥量(默认std::mutex)，本身也满足Lockable，
+chapter4_2.cpp中std::lock_guard、std::unique_lock、adopt_lock/defer_lock/try_to_lock的用法都不用改。
+每次上锁都归属到一个调用点(LockSite，按源代码位置区分)，调用点记录：
+1. 等待时间：从调用lock到拿到锁。先try_lock，成功就记为0，不读时钟；失败才计时并计为一次竞争。
+2. 持有时间：从拿到锁到unlock。
+两者都记在以2为底的对数直方图中(第k个桶表示[2^(k-1), 2^k)纳秒，第0个桶表示0)，报告中给出p50/p99和总时间。
+
+调用点的写法：
+    auto site = PROFILED_LOCK(mtx);
+    std::lock_guard<ProfiledLock<>> lock(site);
+PROFILED_LOCK在展开处定义一个静态的LockSite，返回一个ProfiledLock：它只保存{互斥量, 调用点}两个指针，
+本身也满足Lockable，通过它lock/try_lock/unlock就带上了这个调用点。
+调用点跟着这次调用走，而不是存在互斥量或线程局部变量中，因此std::lock(a, b)同时锁两个
+ProfiledLock时各自归属到自己的调用点，std::lock内部失败的try_lock也不会影响别的上锁。
+只用一次时可以直接写PROFILED_LOCK(mtx).lock()。
+直接写std::lock_guard<ProfiledMutex<>> lock(mtx)时，归属到互斥量构造时给出的调用点，
+用PROFILED_MUTEX_SITE("name")在互斥量的定义处指定，没有指定时归属到"<unnamed>"。
+
+采样：SetLockProfileSampling(n)后每个线程每n次上锁只测量一次，其余的上锁只多一次线程局部计数器的递减，
+可以在生产环境中一直开着。每个样本按采到它时的n计入(次数加n，时间乘以n)，
+因此报告中的次数和总时间直接就是估计值，运行中途调用SetLockProfileSampling改变n也不会算错。
+
+DumpLockProfile按总等待时间从高到低输出所有调用点，ReportLockProfileAtExit在程序退出时输出到std::cerr。
+LockSite是静态对象，注册到一个无锁链表中，永远不会被释放。
+*/
+class LatencyHistogram {
+public:
+    static const int kBuckets = 65;
+
+    // 记录一个代表weight次上锁的样本
+    void Add(uint64_t ns, uint32_t weight = 1) {
+        int bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+        buckets[bucket].fetch_add(weight, std::memory_order_relaxed);
+        total_ns.fetch_add(ns * weight, std::memory_order_relaxed);
+    }
+    uint64_t Count() const {
+        uint64_t count = 0;
+        for(int i = 0; i < kBuckets; ++i) {
+            count += buckets[i].load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+    uint64_t TotalNs() const {
+        return total_ns.load(std::memory_order_relaxed);
+    }
+    // 第q分位所在桶的上界(纳秒)
+    uint64_t Percentile(double q) const {
+        uint64_t count = Count();
+        if(count == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1));
+        uint64_t seen = 0;
+        for(int i = 0; i < kBuckets; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if(seen > rank) {
+                return i == 64 ? ~uint64_t(0) : (uint64_t(1) << i) - 1;
+            }
+        }
+        return ~uint64_t(0);
+    }
+
+private:
+    std::atomic<uint64_t> buckets[kBuckets] = {};
+    std::atomic<uint64_t> total_ns{0};
+};
+
+struct LockSite {
+    LockSite(const char* file, int line, const char* name) : file(file), line(line), name(name) {
+        // 挂到全局链表的头部
+        next = Head().load(std::memory_order_relaxed);
+        while(!Head().compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+    LockSite(const LockSite&) = delete;
+    LockSite& operator=(const LockSite&) = delete;
+
+    static std::atomic<LockSite*>& Head() {
+        static std::atomic<LockSite*> head(nullptr);
+        return head;
+    }
+
+    const char* file;
+    int line;
+    const char* name;
+    std::atomic<uint64_t> contended{0};
+    LatencyHistogram wait;
+    LatencyHistogram hold;
+    LockSite* next;
+};
+
+#define PROFILED_MUTEX_SITE(name) \
+    ([]() -> LockSite& { static LockSite site(__FILE__, __LINE__, name); return site; }())
+#define PROFILED_LOCK(mutex) \
+    ((mutex).at([function = __func__]() -> LockSite& { \
+        static LockSite site(__FILE__, __LINE__, function); return site; }()))
+
+inline std::atomic<uint32_t>& LockProfileSampleEvery() {
+    static std::atomic<uint32_t> every(1);
+    return every;
+}
+
+// 每n次上锁测量一次，n为1时测量每一次
+inline void SetLockProfileSampling(uint32_t n) {
+    LockProfileSampleEvery().store(n == 0 ? 1 : n, std::memory_order_relaxed);
+}
+
+// 这次上锁是否测量：不测量时返回0，测量时返回这个样本代表的上锁次数(取样时的n)
+inline uint32_t LockProfileSampleWeight() {
+    thread_local uint32_t countdown = 0;
+    thread_local uint32_t weight = 1;
+    if(countdown > 0) {
+        --countdown;
+        return 0;
+    }
+    // 上一个样本之后跳过了weight - 1次上锁，这个样本代表它们和自己
+    uint32_t sampled = weight;
+    weight = LockProfileSampleEvery().load(std::memory_order_relaxed);
+    countdown = weight - 1;
+    return sampled;
+}
+
+inline LockSite& UnnamedLockSite() {
+    static LockSite site("", 0, "<unnamed>");
+    return site;
+}
+
+template<typename Mutex>
+class ProfiledMutex;
+
+// 带调用点的ProfiledMutex引用，lock/try_lock归属到site，一般通过PROFILED_LOCK创建
+template<typename Mutex = std::mutex>
+class ProfiledLock {
+public:
+    ProfiledLock(ProfiledMutex<Mutex>& mutex, LockSite& site) : mutex(&mutex), site(&site) {}
+
+    void lock() {
+        mutex->lock(*site);
+    }
+    bool try_lock() {
+        return mutex->try_lock(*site);
+    }
+    void unlock() {
+        mutex->unlock();
+    }
+
+private:
+    ProfiledMutex<Mutex>* mutex;
+    LockSite* site;
+};
+
+template<typename Mutex = std::mutex>
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(LockSite& site = UnnamedLockSite()) : default_site(&site) {}
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    // 返回归属到site的ProfiledLock，一般通过PROFILED_LOCK使用
+    ProfiledLock<Mutex> at(LockSite& site) {
+        return ProfiledLock<Mutex>(*this, site);
+    }
+
+    void lock() {
+        lock(*default_site);
+    }
+    bool try_lock() {
+        return try_lock(*default_site);
+    }
+
+    void lock(LockSite& at_site) {
+        LockSite* site = &at_site;
+        uint32_t weight = LockProfileSampleWeight();
+        if(weight == 0) {
+            mtx.lock();
+            holder_site = nullptr;
+            return;
+        }
+        if(mtx.try_lock()) {
+            Acquired(site, weight, Clock::now(), 0);
+            return;
+        }
+        Clock::time_point start = Clock::now();
+        mtx.lock();
+        Clock::time_point acquired = Clock::now();
+        site->contended.fetch_add(weight, std::memory_order_relaxed);
+        Acquired(site, weight, acquired, ToNs(acquired - start));
+    }
+
+    bool try_lock(LockSite& at_site) {
+        LockSite* site = &at_site;
+        if(!mtx.try_lock()) {
+            return false;
+        }
+        uint32_t weight = LockProfileSampleWeight();
+        if(weight != 0) {
+            Acquired(site, weight, Clock::now(), 0);
+        } else {
+            holder_site = nullptr;
+        }
+        return true;
+    }
+
+    void unlock() {
+        // holder_site、holder_weight和hold_start只有持有锁的线程会读写，它们受mtx本身保护
+        if(holder_site != nullptr) {
+            holder_site->hold.Add(ToNs(Clock::now() - hold_start), holder_weight);
+        }
+        mtx.unlock();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static uint64_t ToNs(Clock::duration d) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+    void Acquired(LockSite* site, uint32_t weight, Clock::time_point acquired, uint64_t wait_ns) {
+        site->wait.Add(wait_ns, weight);
+        holder_site = site;
+        holder_weight = weight;
+        hold_start = acquired;
+    }
+
+    Mutex mtx;
+    LockSite* const default_site;
+    LockSite* holder_site = nullptr;
+    uint32_t holder_weight = 1;
+    Clock::time_point hold_start;
+};
+
+// 按总等待时间从高到低输出所有被采样到的调用点
+inline void DumpLockProfile(std::ostream& os) {
+    std::vector<const LockSite*> sites;
+    for(LockSite* site = LockSite::Head().load(std::memory_order_acquire); site != nullptr; site = site->next) {
+        if(site->wait.Count() != 0) {
+            sites.push_back(site);
+        }
+    }
+    std::sort(sites.begin(), sites.end(), [](const LockSite* a, const LockSite* b) {
+        return a->wait.TotalNs() > b->wait.TotalNs();
+    });
+    os << "lock profile (estimated, currently sampling 1 in " << LockProfileSampleEvery().load(std::memory_order_relaxed)
+       << " acquisitions, times in ns)\n";
+    os << std::left << std::setw(36) << "site" << std::right
+       << std::setw(10) << "acquired" << std::setw(10) << "contended"
+       << std::setw(14) << "wait total" << std::setw(10) << "wait p50" << std::setw(10) << "wait p99"
+       << std::setw(14) << "hold total" << std::setw(10) << "hold p50" << std::setw(10) << "hold p99" << "\n";
+    for(const LockSite* site : sites) {
+        std::string where = std::string(site->name);
+        if(site->line != 0) {
+            const char* slash = site->file;
+            for(const char* p = site->file; *p != '\0'; ++p) {
+                if(*p == '/') {
+                    slash = p + 1;
+                }
+            }
+            where += std::string(" ") + slash + ":" + std::to_string(site->line);
+        }
+        os << std::left << std::setw(36) << where << std::right
+           << std::setw(10) << site->wait.Count()
+           << std::setw(10) << site->contended.load(std::memory_order_relaxed)
+           << std::setw(14) << site->wait.TotalNs()
+           << std::setw(10) << site->wait.Percentile(0.5)
+           << std::setw(10) << site->wait.Percentile(0.99)
+           << std::setw(14) << site->hold.TotalNs()
+           << std::setw(10) << site->hold.Percentile(0.5)
+           << std::setw(10) << site->hold.Percentile(0.99) << "\n";
+    }
+}
+
+// 程序退出时把报告输出到std::cerr，多次调用只注册一次
+inline void ReportLockProfileAtExit() {
+    static bool registered = (std::atexit([] { DumpLockProfile(std::cerr); }) == 0);
+    (void)registered;
+}
+
+#endif
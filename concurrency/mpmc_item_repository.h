@@ -0,0 +1,266 @@
+#ifndef MPMC_ITEM_REPOSITORY_H
+#define MPMC_ITEM_REPOSITORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "cache_line.h"
+#include "item_slot.h"
+#include "wait_strategy.h"
+
+/*
+多生产者多消费者(MPMC)的有界无锁队列版ItemRepository(Dmitry Vyukov的算法)
+
+ProducerAndComsumer4.cpp中所有生产者和消费者都在ir.mtx上串行，
+并且每次notify_all都会唤醒所有线程。这里每个槽位带一个sequence序号，
+用序号代替互斥量来协调生产者和消费者：
+1. 初始时第i个槽位的sequence为i。
+2. 生产者读取write_position(pos)，若槽位sequence == pos，说明槽位空闲，
+   用CAS把write_position推进到pos + 1来占有该槽位，写入产品后把sequence置为pos + 1。
+   若sequence < pos，说明该槽位上一轮的产品还没被取走，即缓冲区满。
+3. 消费者读取read_position(pos)，若槽位sequence == pos + 1，说明产品已经写好，
+   用CAS把read_position推进到pos + 1来占有该槽位，读出产品后把sequence置为pos + size，
+   即下一轮生产者期望的值。若sequence < pos + 1，说明缓冲区空。
+
+生产者之间只在write_position上竞争一次CAS，消费者之间只在read_position上竞争，
+生产者和消费者只在同一个槽位上通过sequence交接，互不阻塞。
+容量被向上取整为2的幂，下标回绕用位与代替取模。
+产品在槽位上原地构造、移动取出，T可以是只能移动的类型。
+
+关闭(close)：CloseItemRepository把write_position的最高位置1，此后生产者的CAS都会失败，
+生产被拒绝；已经占有槽位的生产者仍然会把产品写完。消费者取完剩余的产品
+(read_position追上write_position)后，ConsumeItem(ir, item)返回false，表示产品流结束。
+
+缓冲区满或空时按WaitStrategy等待(见wait_strategy.h)，需要睡眠时每次只唤醒一个线程，而不是notify_all。
+*/
+template<typename T>
+struct MpmcCell {
+    std::atomic<std::size_t> sequence;
+    ItemSlot<T> slot;
+};
+
+template<typename T, std::size_t Capacity = 1024, typename WaitStrategy = SpinThenParkWait>
+class MpmcItemRepository {
+public:
+    static constexpr std::size_t kCapacity = RoundUpPowerOfTwo(Capacity);
+    static constexpr std::size_t kMask = kCapacity - 1;
+    // write_position的最高位表示产品库已关闭
+    static constexpr std::size_t kClosedBit = ~(~std::size_t(0) >> 1);
+
+    MpmcItemRepository() {
+        for(std::size_t i = 0; i < kCapacity; ++i) {
+            item_buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpmcItemRepository(const MpmcItemRepository&) = delete;
+    MpmcItemRepository& operator=(const MpmcItemRepository&) = delete;
+    ~MpmcItemRepository() {
+        // 析构没有被取走的产品
+        std::size_t wpos = write_position.load(std::memory_order_relaxed) & ~kClosedBit;
+        for(std::size_t rpos = read_position.load(std::memory_order_relaxed); rpos != wpos; ++rpos) {
+            item_buffer[rpos & kMask].slot.Destroy();
+        }
+    }
+
+    // 生产者竞争的写入位置
+    alignas(kCacheLineSize) std::atomic<std::size_t> write_position{0};
+    // 消费者竞争的读取位置
+    alignas(kCacheLineSize) std::atomic<std::size_t> read_position{0};
+
+    // 指示产品缓冲区不为满/不为空的等待点
+    alignas(kCacheLineSize) typename WaitStrategy::WaitPoint repo_not_full;
+    alignas(kCacheLineSize) typename WaitStrategy::WaitPoint repo_not_empty;
+
+    // 产品缓冲区
+    alignas(kCacheLineSize) MpmcCell<T> item_buffer[kCapacity];
+};
+
+// 清空产品库，析构剩余的产品。调用时不能有生产者和消费者在运行
+template<typename T, std::size_t C, typename W>
+void InitItemRepository(MpmcItemRepository<T, C, W>& ir) {
+    std::size_t wpos = ir.write_position.load(std::memory_order_relaxed) & ~ir.kClosedBit;
+    for(std::size_t rpos = ir.read_position.load(std::memory_order_relaxed); rpos != wpos; ++rpos) {
+        ir.item_buffer[rpos & ir.kMask].slot.Destroy();
+    }
+    for(std::size_t i = 0; i < ir.kCapacity; ++i) {
+        ir.item_buffer[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    ir.write_position.store(0, std::memory_order_relaxed);
+    ir.read_position.store(0, std::memory_order_relaxed);
+}
+
+// 关闭产品库：之后的生产都被拒绝，消费者取完剩余产品后得到结束信号。
+// 唤醒所有等待中的生产者和消费者，让它们重新检查状态。
+template<typename T, std::size_t C, typename W>
+void CloseItemRepository(MpmcItemRepository<T, C, W>& ir) {
+    ir.write_position.fetch_or(ir.kClosedBit, std::memory_order_acq_rel);
+    W::NotifyAll(ir.repo_not_full);
+    W::NotifyAll(ir.repo_not_empty);
+}
+
+template<typename T, std::size_t C, typename W>
+bool MpmcIsClosed(MpmcItemRepository<T, C, W>& ir) {
+    return (ir.write_position.load(std::memory_order_acquire) & ir.kClosedBit) != 0;
+}
+
+// 产品库已关闭，并且所有产品都已被消费者占有
+template<typename T, std::size_t C, typename W>
+bool MpmcIsDrained(MpmcItemRepository<T, C, W>& ir) {
+    std::size_t wpos = ir.write_position.load(std::memory_order_acquire);
+    return (wpos & ir.kClosedBit) != 0
+            && ir.read_position.load(std::memory_order_acquire) == (wpos & ~ir.kClosedBit);
+}
+
+// 占有下一个可写的槽位，缓冲区满或产品库已关闭时返回nullptr
+template<typename T, std::size_t C, typename W>
+MpmcCell<T>* MpmcClaimWriteCell(MpmcItemRepository<T, C, W>& ir, std::size_t& pos) {
+    pos = ir.write_position.load(std::memory_order_relaxed);
+    while(1) {
+        if(pos & ir.kClosedBit) {
+            return nullptr;
+        }
+        MpmcCell<T>* cell = &ir.item_buffer[pos & ir.kMask];
+        std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+        std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+        if(diff == 0) {
+            // 槽位空闲，尝试占有；失败时pos被更新为最新的write_position
+            if(ir.write_position.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return cell;
+            }
+        } else if(diff < 0) {
+            // 上一轮的产品还没被取走，缓冲区满
+            return nullptr;
+        } else {
+            // 其他生产者已经占有了该槽位
+            pos = ir.write_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// 占有下一个可读的槽位，缓冲区空时返回nullptr
+template<typename T, std::size_t C, typename W>
+MpmcCell<T>* MpmcClaimReadCell(MpmcItemRepository<T, C, W>& ir, std::size_t& pos) {
+    pos = ir.read_position.load(std::memory_order_relaxed);
+    while(1) {
+        MpmcCell<T>* cell = &ir.item_buffer[pos & ir.kMask];
+        std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+        std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+        if(diff == 0) {
+            if(ir.read_position.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return cell;
+            }
+        } else if(diff < 0) {
+            // 产品还没写好，缓冲区空
+            return nullptr;
+        } else {
+            pos = ir.read_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// 非阻塞生产，在槽位上用args原地构造产品，缓冲区满或已关闭时返回false(args不会被移动)
+template<typename T, std::size_t C, typename W, typename... Args>
+bool TryEmplaceItem(MpmcItemRepository<T, C, W>& ir, Args&&... args) {
+    std::size_t pos;
+    MpmcCell<T>* cell = MpmcClaimWriteCell(ir, pos);
+    if(cell == nullptr) {
+        return false;
+    }
+    cell->slot.Emplace(std::forward<Args>(args)...);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    W::Notify(ir.repo_not_empty);
+    return true;
+}
+
+template<typename T, std::size_t C, typename W, typename U>
+bool TryProduceItem(MpmcItemRepository<T, C, W>& ir, U&& item) {
+    return TryEmplaceItem(ir, std::forward<U>(item));
+}
+
+// 非阻塞消费，缓冲区空时返回false
+template<typename T, std::size_t C, typename W>
+bool TryConsumeItem(MpmcItemRepository<T, C, W>& ir, T& item) {
+    std::size_t pos;
+    MpmcCell<T>* cell = MpmcClaimReadCell(ir, pos);
+    if(cell == nullptr) {
+        return false;
+    }
+    item = cell->slot.Take();
+    cell->sequence.store(pos + ir.kCapacity, std::memory_order_release);
+    W::Notify(ir.repo_not_full);
+    return true;
+}
+
+// 下一个写入位置的槽位是否空闲
+template<typename T, std::size_t C, typename W>
+bool MpmcHasFreeSlot(MpmcItemRepository<T, C, W>& ir) {
+    std::size_t pos = ir.write_position.load(std::memory_order_relaxed) & ~ir.kClosedBit;
+    std::size_t seq = ir.item_buffer[pos & ir.kMask].sequence.load(std::memory_order_acquire);
+    return static_cast<std::intptr_t>(seq - pos) >= 0;
+}
+
+// 下一个读取位置的槽位是否已有产品
+template<typename T, std::size_t C, typename W>
+bool MpmcHasItem(MpmcItemRepository<T, C, W>& ir) {
+    std::size_t pos = ir.read_position.load(std::memory_order_relaxed);
+    std::size_t seq = ir.item_buffer[pos & ir.kMask].sequence.load(std::memory_order_acquire);
+    return static_cast<std::intptr_t>(seq - (pos + 1)) >= 0;
+}
+
+// 阻塞生产，产品库已关闭时返回kClosed
+template<typename T, std::size_t C, typename W, typename... Args>
+ProduceStatus EmplaceItem(MpmcItemRepository<T, C, W>& ir, Args&&... args) {
+    while(!TryEmplaceItem(ir, std::forward<Args>(args)...)) {
+        if(MpmcIsClosed(ir)) {
+            return ProduceStatus::kClosed;
+        }
+        // 生产者需要等待产品缓冲区不为满
+        W::WaitFor(ir.repo_not_full, [&ir] { return MpmcHasFreeSlot(ir) || MpmcIsClosed(ir); });
+    }
+    return ProduceStatus::kOk;
+}
+
+template<typename T, std::size_t C, typename W, typename U>
+ProduceStatus ProduceItem(MpmcItemRepository<T, C, W>& ir, U&& item) {
+    return EmplaceItem(ir, std::forward<U>(item));
+}
+
+// 取出一个产品，缓冲区空时阻塞。产品库关闭并且已经取完时返回false(产品流结束)
+template<typename T, std::size_t C, typename W>
+bool ConsumeItem(MpmcItemRepository<T, C, W>& ir, T& item) {
+    std::size_t pos;
+    MpmcCell<T>* cell;
+    while((cell = MpmcClaimReadCell(ir, pos)) == nullptr) {
+        if(MpmcIsDrained(ir)) {
+            return false;
+        }
+        // 消费者等待生产者生产产品，或者产品库被排空
+        W::WaitFor(ir.repo_not_empty, [&ir] { return MpmcHasItem(ir) || MpmcIsDrained(ir); });
+    }
+    item = cell->slot.Take();
+    cell->sequence.store(pos + ir.kCapacity, std::memory_order_release);
+    W::Notify(ir.repo_not_full);
+    if(MpmcIsClosed(ir)) {
+        // 关闭后可能有消费者在等待最后几个还没写完的产品，排空时要叫醒所有人
+        W::NotifyAll(ir.repo_not_empty);
+    }
+    return true;
+}
+
+// 取出一个产品，缓冲区空时阻塞。不检查关闭状态，关闭后请使用ConsumeItem(ir, item)
+template<typename T, std::size_t C, typename W>
+T ConsumeItem(MpmcItemRepository<T, C, W>& ir) {
+    std::size_t pos;
+    MpmcCell<T>* cell;
+    while((cell = MpmcClaimReadCell(ir, pos)) == nullptr) {
+        // 消费者等待生产者生产产品
+        W::WaitFor(ir.repo_not_empty, [&ir] { return MpmcHasItem(ir); });
+    }
+    T data = cell->slot.Take();
+    cell->sequence.store(pos + ir.kCapacity, std::memory_order_release);
+    W::Notify(ir.repo_not_full);
+    return data;
+}
+
+#endif
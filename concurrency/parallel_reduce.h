@@ -0,0 +1,52 @@
+#ifndef PARALLEL_REDUCE_H
+#define PARALLEL_REDUCE_H
+
+#include <cstddef>
+#include <vector>
+#include "thread_pool.h"
+
+/*
+确定性的并行归约
+
+把[first, last)按固定的grain切成块，在线程池上并行地计算每一块的部分结果chunk(begin, end)，
+再把部分结果按块的顺序两两相加(pairwise summation)。
+块的划分只取决于区间和grain，和线程数、哪个线程执行了哪一块都无关，
+相加的顺序也是固定的，因此同一个输入无论用几个线程，结果都逐位相同。
+两两相加的舍入误差随块数按log增长，而逐个累加是线性增长。
+
+T需要支持默认构造(零值)和operator+。块内部的求和方式由chunk决定，例如simd_sine.h的SineSum。
+*/
+template<typename T>
+T PairwiseSum(const T* values, std::size_t n) {
+    if(n <= 8) {
+        T sum = T();
+        for(std::size_t i = 0; i < n; ++i) {
+            sum = sum + values[i];
+        }
+        return sum;
+    }
+    std::size_t half = n / 2;
+    return PairwiseSum(values, half) + PairwiseSum(values + half, n - half);
+}
+
+template<typename Index, typename ChunkFn>
+auto parallel_reduce(ThreadPool& pool, Index first, Index last, Index grain, ChunkFn&& chunk)
+    -> decltype(chunk(first, last)) {
+    using T = decltype(chunk(first, last));
+    if(!(first < last)) {
+        return T();
+    }
+    if(grain < 1) {
+        grain = 1;
+    }
+    Index chunks = (last - first + grain - 1) / grain;
+    std::vector<T> partial(static_cast<std::size_t>(chunks));
+    parallel_for(pool, Index(0), chunks, [&](Index c) {
+        Index begin = first + c * grain;
+        Index end = last - begin > grain ? begin + grain : last;
+        partial[static_cast<std::size_t>(c)] = chunk(begin, end);
+    });
+    return PairwiseSum(partial.data(), partial.size());
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef PIPELINE_ITEM_REPOSITORY_H
+#define PIPELINE_ITEM_REPOSITORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "cache_line.h"
+#include "item_slot.h"
+#include "wait_strategy.h"
+
+/*
+多阶段流水线(disruptor风格)版ItemRepository
+
+produce -> parse -> enrich -> sink这样的流水线如果用多个ItemRepository串起来，
+每经过一个阶段产品都要被移出、再放入下一个ItemRepository，每一跳都有一次拷贝/移动和一次入队出队。
+这里所有阶段共享同一个环形缓冲区：
+1. 生产者在槽位上原地构造产品，产品只写入一次。
+2. 每个阶段有自己的游标(cursor)，表示本阶段已经处理完的产品位置，
+   第k个阶段只处理第k-1个阶段(第0个阶段看生产者)已经处理完的产品，直接在槽位上读写，不拷贝。
+3. 最后一个阶段处理完的槽位才能被生产者复用，最后一个阶段处理完后析构槽位中的产品。
+所以一个产品在流水线中的顺序总是：生产者 -> 阶段0 -> 阶段1 -> ... -> 阶段Stages-1。
+
+游标和SpscItemRepository的读写位置一样是单调递增的计数器，
+cursors[0]是生产者的写位置，cursors[k + 1]是第k个阶段的游标，各自独占一个cache line，
+并带有一个等待点：游标前进后通知在它上面等待的下游(生产者等待最后一个阶段)。
+
+每个阶段一次处理上游已经完成的一整批产品，最后才推进一次游标并通知一次，
+下游落后时批量追赶，游标的写入和唤醒被分摊到整批产品上。
+
+只有一个生产者，每个阶段只能由一个线程处理。
+*/
+template<typename T, std::size_t Stages, std::size_t Capacity = 1024, typename WaitStrategy = SpinThenParkWait>
+class PipelineItemRepository {
+public:
+    static_assert(Stages > 0, "a pipeline needs at least one stage");
+    static constexpr std::size_t kCapacity = RoundUpPowerOfTwo(Capacity);
+    static constexpr std::size_t kMask = kCapacity - 1;
+    static constexpr std::size_t kStages = Stages;
+
+    PipelineItemRepository() = default;
+    PipelineItemRepository(const PipelineItemRepository&) = delete;
+    PipelineItemRepository& operator=(const PipelineItemRepository&) = delete;
+    ~PipelineItemRepository() {
+        // 析构最后一个阶段还没有处理完的产品
+        std::size_t wpos = cursors[0].position.load(std::memory_order_relaxed);
+        for(std::size_t pos = cursors[Stages].position.load(std::memory_order_relaxed); pos != wpos; ++pos) {
+            item_buffer[pos & kMask].Destroy();
+        }
+    }
+
+    struct alignas(kCacheLineSize) Cursor {
+        std::atomic<std::size_t> position{0};
+        // 指示position前进了的等待点
+        typename WaitStrategy::WaitPoint advanced;
+    };
+
+    // cursors[0]: 生产者，cursors[k + 1]: 第k个阶段
+    Cursor cursors[Stages + 1];
+    alignas(kCacheLineSize) std::atomic<bool> closed{false};
+
+    // 产品缓冲区
+    alignas(kCacheLineSize) ItemSlot<T> item_buffer[kCapacity];
+};
+
+// 清空产品库，析构剩余的产品。调用时不能有生产者和任何阶段在运行
+template<typename T, std::size_t S, std::size_t C, typename W>
+void InitItemRepository(PipelineItemRepository<T, S, C, W>& ir) {
+    std::size_t wpos = ir.cursors[0].position.load(std::memory_order_relaxed);
+    for(std::size_t pos = ir.cursors[S].position.load(std::memory_order_relaxed); pos != wpos; ++pos) {
+        ir.item_buffer[pos & ir.kMask].Destroy();
+    }
+    for(std::size_t i = 0; i <= S; ++i) {
+        ir.cursors[i].position.store(0, std::memory_order_relaxed);
+    }
+    ir.closed.store(false, std::memory_order_relaxed);
+}
+
+// 关闭产品库：生产者不再生产，各阶段处理完剩余产品后ProcessItems返回0
+template<typename T, std::size_t S, std::size_t C, typename W>
+void CloseItemRepository(PipelineItemRepository<T, S, C, W>& ir) {
+    ir.closed.store(true, std::memory_order_release);
+    for(std::size_t i = 0; i <= S; ++i) {
+        W::NotifyAll(ir.cursors[i].advanced);
+    }
+}
+
+template<typename T, std::size_t S, std::size_t C, typename W>
+bool PipelineIsClosed(PipelineItemRepository<T, S, C, W>& ir) {
+    return ir.closed.load(std::memory_order_acquire);
+}
+
+template<typename T, std::size_t S, std::size_t C, typename W>
+bool PipelineHasFreeSlot(PipelineItemRepository<T, S, C, W>& ir) {
+    return ir.cursors[0].position.load(std::memory_order_relaxed)
+            - ir.cursors[S].position.load(std::memory_order_acquire) < ir.kCapacity;
+}
+
+// 第stage个阶段是否有上游已经处理完、本阶段还没处理的产品
+template<typename T, std::size_t S, std::size_t C, typename W>
+bool PipelineHasItem(PipelineItemRepository<T, S, C, W>& ir, std::size_t stage) {
+    return ir.cursors[stage + 1].position.load(std::memory_order_relaxed)
+            != ir.cursors[stage].position.load(std::memory_order_acquire);
+}
+
+// 产品库已关闭，并且第stage个阶段已经处理完所有产品
+template<typename T, std::size_t S, std::size_t C, typename W>
+bool PipelineIsDrained(PipelineItemRepository<T, S, C, W>& ir, std::size_t stage) {
+    // 生产者先发布写位置再关闭，看到closed之后读到的写位置就是最终的写位置
+    return PipelineIsClosed(ir)
+            && ir.cursors[stage + 1].position.load(std::memory_order_relaxed)
+                == ir.cursors[0].position.load(std::memory_order_acquire);
+}
+
+// 非阻塞生产，在槽位上用args原地构造产品。缓冲区满或产品库已关闭时返回false(args不会被移动)
+template<typename T, std::size_t S, std::size_t C, typename W, typename... Args>
+bool TryEmplaceItem(PipelineItemRepository<T, S, C, W>& ir, Args&&... args) {
+    if(PipelineIsClosed(ir) || !PipelineHasFreeSlot(ir)) {
+        return false;
+    }
+    std::size_t wpos = ir.cursors[0].position.load(std::memory_order_relaxed);
+    ir.item_buffer[wpos & ir.kMask].Emplace(std::forward<Args>(args)...);
+    ir.cursors[0].position.store(wpos + 1, std::memory_order_release);
+    W::Notify(ir.cursors[0].advanced);
+    return true;
+}
+
+template<typename T, std::size_t S, std::size_t C, typename W, typename U>
+bool TryProduceItem(PipelineItemRepository<T, S, C, W>& ir, U&& item) {
+    return TryEmplaceItem(ir, std::forward<U>(item));
+}
+
+// 阻塞生产，产品库已关闭时返回kClosed
+template<typename T, std::size_t S, std::size_t C, typename W, typename... Args>
+ProduceStatus EmplaceItem(PipelineItemRepository<T, S, C, W>& ir, Args&&... args) {
+    while(!TryEmplaceItem(ir, std::forward<Args>(args)...)) {
+        if(PipelineIsClosed(ir)) {
+            return ProduceStatus::kClosed;
+        }
+        // 生产者需要等待最后一个阶段腾出槽位
+        W::WaitFor(ir.cursors[S].advanced, [&ir] { return PipelineHasFreeSlot(ir) || PipelineIsClosed(ir); });
+    }
+    return ProduceStatus::kOk;
+}
+
+template<typename T, std::size_t S, std::size_t C, typename W, typename U>
+ProduceStatus ProduceItem(PipelineItemRepository<T, S, C, W>& ir, U&& item) {
+    return EmplaceItem(ir, std::forward<U>(item));
+}
+
+/*
+第stage个阶段处理一批产品：上游没有新产品时阻塞，
+然后对上游已经处理完、本阶段还没处理的产品(最多max_batch个)依次调用handler(T&)，
+最后推进一次本阶段的游标。handler直接修改槽位中的产品，下游阶段能看到修改结果。
+最后一个阶段处理完一个产品后析构它，handler可以把产品移走。
+返回本批处理的产品数，产品库关闭并且本阶段已处理完所有产品时返回0。
+*/
+template<typename T, std::size_t S, std::size_t C, typename W, typename Handler>
+std::size_t ProcessItems(PipelineItemRepository<T, S, C, W>& ir, std::size_t stage, Handler&& handler,
+                         std::size_t max_batch = SIZE_MAX) {
+    typename PipelineItemRepository<T, S, C, W>::Cursor& upstream = ir.cursors[stage];
+    typename PipelineItemRepository<T, S, C, W>::Cursor& self = ir.cursors[stage + 1];
+    std::size_t pos = self.position.load(std::memory_order_relaxed);
+    std::size_t available = upstream.position.load(std::memory_order_acquire);
+    while(available == pos) {
+        if(PipelineIsDrained(ir, stage)) {
+            return 0;
+        }
+        // 等待上游阶段处理完新的产品
+        W::WaitFor(upstream.advanced, [&ir, stage] {
+            return PipelineHasItem(ir, stage) || PipelineIsDrained(ir, stage);
+        });
+        available = upstream.position.load(std::memory_order_acquire);
+    }
+    std::size_t count = available - pos;
+    if(count > max_batch) {
+        count = max_batch;
+    }
+    bool last_stage = stage + 1 == S;
+    for(std::size_t i = 0; i < count; ++i) {
+        ItemSlot<T>& slot = ir.item_buffer[(pos + i) & ir.kMask];
+        handler(slot.Get());
+        if(last_stage) {
+            slot.Destroy();
+        }
+    }
+    self.position.store(pos + count, std::memory_order_release);
+    W::Notify(self.advanced);
+    return count;
+}
+
+#endif
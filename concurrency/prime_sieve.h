@@ -0,0 +1,251 @@
+#ifndef PRIME_SIEVE_H
+#define PRIME_SIEVE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+#include "parallel_reduce.h"
+#include "thread_pool.h"
+
+/*
+分段、并行的埃拉托斯特尼筛法
+
+chapter6_3.cpp的is_prime(x)从2到x-1逐个试除，判断一个十亿级的数就要十亿次除法；
+统计一个区间内的素数个数更是要对每个数都这样做一遍。
+PrimeSieve用筛法一次性标出整段区间的素数：
+1. 只存奇数，每个奇数一个比特(bit k表示段起点lo之后的奇数lo+2k+1)，
+   32KiB的段(L1 cache大小)覆盖524288个数，筛的过程中整段都留在cache里。
+2. 轮式分解(wheel)：偶数不存(模2的轮)；3、5、7、11、13的倍数不逐个划掉，
+   而是预先算好周期为3*5*7*11*13个奇数的比特模式，每段开始时直接按偏移拷贝进来。
+3. 其余不超过sqrt(limit)的素数p(基础素数)从max(p*p, 段内第一个奇数倍)开始，每隔p个比特划掉一个。
+4. 各段互不依赖，按段在线程池上并行(parallel_reduce，见parallel_reduce.h)，每段用线程局部的缓冲区。
+
+接口：
+- is_prime(n): n小于table_limit时查预先筛好的表；更大的n用基础素数试除(最多sqrt(n)以内的素数)。
+- count_primes(lo, hi): [lo, hi)中素数的个数，只做popcount，不生成素数。
+- primes_in_range(lo, hi): 按从小到大的顺序返回[lo, hi)中的素数。
+n和区间都必须小于构造时给出的limit，否则抛出std::out_of_range。
+*/
+static const std::size_t kSieveSegmentBytes = 32 * 1024;
+static const uint64_t kSieveSegmentSpan = kSieveSegmentBytes * 16; // 每段覆盖的数(每字节8个奇数)
+
+class PrimeSieve {
+public:
+    PrimeSieve(ThreadPool& pool, uint64_t limit, uint64_t table_limit = uint64_t(1) << 24)
+        : pool(pool), max(limit) {
+        BuildWheelPattern();
+        BuildBasePrimes();
+        BuildTable(std::min(table_limit, limit));
+    }
+    PrimeSieve(const PrimeSieve&) = delete;
+    PrimeSieve& operator=(const PrimeSieve&) = delete;
+
+    uint64_t limit() const {
+        return max;
+    }
+
+    bool is_prime(uint64_t n) const {
+        CheckRange(n, n + 1);
+        if(n < 2 || n % 2 == 0) {
+            return n == 2;
+        }
+        if(n < table_size) {
+            return (table[n / 16] >> ((n / 2) % 8)) & 1;
+        }
+        for(uint32_t p : base_primes) {
+            if(uint64_t(p) * p > n) {
+                break;
+            }
+            if(n % p == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t count_primes(uint64_t lo, uint64_t hi) const {
+        CheckRange(lo, hi);
+        if(lo >= hi) {
+            return 0;
+        }
+        uint64_t count = lo <= 2 && 2 < hi ? 1 : 0;
+        return count + parallel_reduce(pool, lo / kSieveSegmentSpan, (hi - 1) / kSieveSegmentSpan + 1, uint64_t(1),
+                                       [this, lo, hi](uint64_t first, uint64_t last) {
+            uint64_t sum = 0;
+            for(uint64_t s = first; s < last; ++s) {
+                sum += CountSegment(s, lo, hi);
+            }
+            return sum;
+        });
+    }
+
+    std::vector<uint64_t> primes_in_range(uint64_t lo, uint64_t hi) const {
+        CheckRange(lo, hi);
+        std::vector<uint64_t> result;
+        if(lo >= hi) {
+            return result;
+        }
+        if(lo <= 2 && 2 < hi) {
+            result.push_back(2);
+        }
+        uint64_t first = lo / kSieveSegmentSpan;
+        uint64_t last = (hi - 1) / kSieveSegmentSpan + 1;
+        std::vector<std::vector<uint64_t>> parts(last - first);
+        parallel_for(pool, first, last, [&](uint64_t s) {
+            CollectSegment(s, lo, hi, parts[s - first]);
+        }, uint64_t(1));
+        for(auto& part : parts) {
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        return result;
+    }
+
+private:
+    // 预筛掉的小素数，它们的乘积是比特模式的周期(以奇数计)
+    static constexpr uint32_t kWheelPeriod = 3 * 5 * 7 * 11 * 13;
+    static constexpr uint32_t kFirstSievingPrime = 17;
+
+    void CheckRange(uint64_t lo, uint64_t hi) const {
+        if(hi > max || lo > hi) {
+            throw std::out_of_range("PrimeSieve query outside [0, limit)");
+        }
+    }
+
+    // 第g个奇数(2g+1)对应比特g，模式长kWheelPeriod字节，即8*kWheelPeriod个奇数，是周期的整数倍
+    void BuildWheelPattern() {
+        wheel.assign(kWheelPeriod, 0xFF);
+        for(uint32_t p : {3u, 5u, 7u, 11u, 13u}) {
+            for(uint64_t g = p / 2; g < uint64_t(kWheelPeriod) * 8; g += p) {
+                wheel[g / 8] &= static_cast<uint8_t>(~(1u << (g % 8)));
+            }
+        }
+    }
+
+    void BuildBasePrimes() {
+        uint64_t root = 1;
+        while(root * root < max) {
+            ++root;
+        }
+        std::vector<bool> composite(root + 1, false);
+        for(uint64_t i = 2; i <= root; ++i) {
+            if(composite[i]) {
+                continue;
+            }
+            base_primes.push_back(static_cast<uint32_t>(i));
+            for(uint64_t j = i * i; j <= root; j += i) {
+                composite[j] = true;
+            }
+        }
+    }
+
+    void BuildTable(uint64_t table_limit) {
+        table_size = table_limit;
+        std::size_t bytes = static_cast<std::size_t>((table_limit + 15) / 16);
+        table.assign(bytes, 0);
+        std::size_t segments = (bytes + kSieveSegmentBytes - 1) / kSieveSegmentBytes;
+        parallel_for(pool, std::size_t(0), segments, [&](std::size_t s) {
+            std::size_t offset = s * kSieveSegmentBytes;
+            SieveSegment(uint64_t(offset) * 16, std::min(kSieveSegmentBytes, bytes - offset), &table[offset]);
+        }, std::size_t(1));
+    }
+
+    /*
+    筛[lo, lo + 16 * bytes)，lo必须是16的倍数，结果写入bits：比特k为1表示lo+2k+1是素数。
+    */
+    void SieveSegment(uint64_t lo, std::size_t bytes, uint8_t* bits) const {
+        std::size_t offset = static_cast<std::size_t>((lo / 16) % kWheelPeriod);
+        for(std::size_t filled = 0; filled < bytes;) {
+            std::size_t n = std::min(bytes - filled, std::size_t(kWheelPeriod) - offset);
+            std::memcpy(bits + filled, &wheel[offset], n);
+            filled += n;
+            offset = 0;
+        }
+        uint64_t hi = lo + uint64_t(bytes) * 16;
+        uint64_t nbits = uint64_t(bytes) * 8;
+        for(uint32_t p : base_primes) {
+            if(p < kFirstSievingPrime) {
+                continue;
+            }
+            uint64_t start = uint64_t(p) * p;
+            if(start >= hi) {
+                break;
+            }
+            if(start < lo) {
+                start = (lo + p - 1) / p * p;
+            }
+            if(start % 2 == 0) {
+                start += p;
+            }
+            for(uint64_t k = (start - lo) / 2; k < nbits; k += p) {
+                bits[k / 8] &= static_cast<uint8_t>(~(1u << (k % 8)));
+            }
+        }
+        if(lo == 0) {
+            // 1不是素数；模式把预筛的素数本身也划掉了，补回来
+            bits[0] &= static_cast<uint8_t>(~1u);
+            for(uint64_t p : {3u, 5u, 7u, 11u, 13u}) {
+                if(p < hi) {
+                    bits[p / 16] |= static_cast<uint8_t>(1u << ((p / 2) % 8));
+                }
+            }
+        }
+    }
+
+    // 段内比特k对应lo+2k+1，返回第一个不小于n的奇数对应的比特
+    static uint64_t FirstBit(uint64_t lo, uint64_t n) {
+        return n <= lo + 1 ? 0 : (n - lo) / 2;
+    }
+
+    static uint8_t* SegmentBuffer() {
+        thread_local std::vector<uint8_t> buffer(kSieveSegmentBytes);
+        return buffer.data();
+    }
+
+    uint64_t CountSegment(uint64_t s, uint64_t lo, uint64_t hi) const {
+        uint64_t base = s * kSieveSegmentSpan;
+        uint8_t* bits = SegmentBuffer();
+        SieveSegment(base, kSieveSegmentBytes, bits);
+        uint64_t kb = FirstBit(base, lo);
+        uint64_t ke = std::min<uint64_t>(FirstBit(base, hi), kSieveSegmentBytes * 8);
+        uint64_t count = 0;
+        uint64_t k = kb;
+        for(; k < ke && k % 64 != 0; ++k) {
+            count += (bits[k / 8] >> (k % 8)) & 1;
+        }
+        for(; k + 64 <= ke; k += 64) {
+            uint64_t word;
+            std::memcpy(&word, bits + k / 8, sizeof(word));
+            count += __builtin_popcountll(word);
+        }
+        for(; k < ke; ++k) {
+            count += (bits[k / 8] >> (k % 8)) & 1;
+        }
+        return count;
+    }
+
+    void CollectSegment(uint64_t s, uint64_t lo, uint64_t hi, std::vector<uint64_t>& out) const {
+        uint64_t base = s * kSieveSegmentSpan;
+        uint8_t* bits = SegmentBuffer();
+        SieveSegment(base, kSieveSegmentBytes, bits);
+        uint64_t ke = std::min<uint64_t>(FirstBit(base, hi), kSieveSegmentBytes * 8);
+        for(uint64_t k = FirstBit(base, lo); k < ke; ++k) {
+            if((bits[k / 8] >> (k % 8)) & 1) {
+                out.push_back(base + 2 * k + 1);
+            }
+        }
+    }
+
+    ThreadPool& pool;
+    const uint64_t max;
+    std::vector<uint8_t> wheel;
+    std::vector<uint32_t> base_primes;
+    // [0, table_size)的筛选结果，格式和一段相同
+    std::vector<uint8_t> table;
+    uint64_t table_size = 0;
+};
+
+#endif
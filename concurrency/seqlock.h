@@ -0,0 +1,107 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include "cache_line.h"
+#include "wait_strategy.h"
+
+/*
+顺序锁(seqlock)，用于小的、可平凡拷贝的快照(配置、行情、统计值)
+
+读写锁的读者至少要写一次共享的计数器，seqlock的读者完全不写共享内存：
+1. 写者把seq从偶数改成奇数，写入数据，再把seq加一变回偶数。
+2. 读者先读seq(必须是偶数)，拷贝数据，再读一次seq，两次相同说明拷贝期间没有写入，否则重试。
+读者之间没有任何竞争，也不会阻塞写者；代价是写入频繁时读者要重试，并且读到的只能是拷贝。
+
+数据按8字节的原子字存放，读写都用relaxed的原子操作，配合两侧的栅栏
+(Hans Boehm, "Can Seqlocks Get Along With Programming Language Memory Models?")，
+读者和写者并发访问同一个字也不是数据竞争。
+多个写者之间用seq上的CAS互斥，T必须可平凡拷贝。
+*/
+template<typename T>
+class SeqLock {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable T");
+
+    SeqLock() : SeqLock(T()) {}
+    explicit SeqLock(const T& value) {
+        StoreWords(value);
+    }
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    void Store(const T& value) {
+        // 等seq变为偶数(没有其他写者)，再把它改成奇数
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        for(int spins = 0; ; ++spins) {
+            if((seq & 1) == 0
+                    && sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                                      std::memory_order_relaxed)) {
+                break;
+            }
+            Backoff(spins);
+            seq = sequence.load(std::memory_order_relaxed);
+        }
+        // 数据的写入不能被重排到seq变为奇数之前
+        std::atomic_thread_fence(std::memory_order_release);
+        StoreWords(value);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // 读取一次，期间有写入时返回false
+    bool TryLoad(T& value) const {
+        uint32_t seq0 = sequence.load(std::memory_order_acquire);
+        if(seq0 & 1) {
+            return false;
+        }
+        LoadWords(value);
+        // 数据的读取不能被重排到第二次读seq之后
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == seq0;
+    }
+
+    T Load() const {
+        T value;
+        for(int spins = 0; !TryLoad(value); ++spins) {
+            Backoff(spins);
+        }
+        return value;
+    }
+
+private:
+    // 写者在写入途中被调度出去时，自旋等不到它，先自旋一会儿再让出CPU
+    static void Backoff(int spins) {
+        if(spins < kWaitSpinCount) {
+            CpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    static const std::size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    void StoreWords(const T& value) {
+        uint64_t buffer[kWords] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        for(std::size_t i = 0; i < kWords; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+    void LoadWords(T& value) const {
+        uint64_t buffer[kWords];
+        for(std::size_t i = 0; i < kWords; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        std::memcpy(&value, buffer, sizeof(T));
+    }
+
+    alignas(kCacheLineSize) std::atomic<uint32_t> sequence{0};
+    std::atomic<uint64_t> words[kWords];
+};
+
+#endif
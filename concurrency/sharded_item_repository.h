@@ -0,0 +1,249 @@
+#ifndef SHARDED_ITEM_REPOSITORY_H
+#define SHARDED_ITEM_REPOSITORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include "cache_line.h"
+#include "mpmc_item_repository.h"
+#include "thread_hint.h"
+#include "wait_strategy.h"
+
+/*
+分片(sharded)ItemRepository，带工作窃取(work stealing)
+
+消费者很多时，所有ConsumeItem都在同一个read_position(或同一把ir.mtx)上竞争。
+这里把产品库拆成多个分片，每个分片是一个MpmcItemRepository：
+1. 每个消费者线程有一个"主分片"，平时只从自己的主分片取产品，和其他消费者互不竞争。
+2. 生产者轮流(round-robin)把产品放入各个分片，也可以用ProduceItemByKey按key的哈希选择分片，
+   同一个key的产品总是进入同一个分片。
+3. 消费者的主分片空了，就依次尝试从其他分片"窃取"产品，忙的分片会被空闲的消费者分担。
+4. 所有分片都空(或都满)时，才在整个产品库共用的等待点上等待。
+
+消费者的主分片由每个产品库自己轮流分配：线程第一次在某个产品库上消费时领取next_home的下一个值，
+之后一直使用它。ThisThreadShardHint(见thread_hint.h)是整个进程共用的编号，
+只在某个产品库上消费的线程拿到的编号不一定连续，几个消费者可能落在同一个主分片上互相竞争。
+生产者的轮转起点仍由ThisThreadShardHint决定。
+因此ProduceItem/ConsumeItem的调用方式和其他ItemRepository完全相同。
+分片数一般取消费者数，这样竞争程度基本不随核数增长。
+
+每个分片的容量是Capacity，分片内部不等待(BusySpinWait的Notify是空操作)，
+等待和唤醒都由ShardedItemRepository自己的WaitStrategy负责。
+ProduceItemByKey的生产者只等自己的分片，和普通生产者等待的条件不同，
+因此repo_not_full上总是NotifyAll，避免唤醒了条件不满足的等待者而漏掉别人。
+生产者只有在分片满时才会等待，所以消费者只在取走产品前分片是满的(满->不满)时才通知，
+分片没满时消费的热路径上不碰repo_not_full。
+*/
+template<typename T, std::size_t Capacity = 1024, typename WaitStrategy = SpinThenParkWait>
+class ShardedItemRepository {
+public:
+    using Shard = MpmcItemRepository<T, Capacity, BusySpinWait>;
+
+    explicit ShardedItemRepository(std::size_t shard_count = std::thread::hardware_concurrency())
+        : shard_count(shard_count == 0 ? 1 : shard_count),
+          shards(new Shard[shard_count == 0 ? 1 : shard_count]) {}
+    ShardedItemRepository(const ShardedItemRepository&) = delete;
+    ShardedItemRepository& operator=(const ShardedItemRepository&) = delete;
+
+    const std::size_t shard_count;
+    std::unique_ptr<Shard[]> shards;
+
+    // 下一个分配给消费者的主分片
+    alignas(kCacheLineSize) std::atomic<std::size_t> next_home{0};
+
+    // 指示产品库不为满/不为空的等待点
+    alignas(kCacheLineSize) typename WaitStrategy::WaitPoint repo_not_full;
+    alignas(kCacheLineSize) typename WaitStrategy::WaitPoint repo_not_empty;
+};
+
+// 清空产品库，析构剩余的产品。调用时不能有生产者和消费者在运行
+template<typename T, std::size_t C, typename W>
+void InitItemRepository(ShardedItemRepository<T, C, W>& ir) {
+    for(std::size_t i = 0; i < ir.shard_count; ++i) {
+        InitItemRepository(ir.shards[i]);
+    }
+}
+
+template<typename T, std::size_t C, typename W>
+void CloseItemRepository(ShardedItemRepository<T, C, W>& ir) {
+    for(std::size_t i = 0; i < ir.shard_count; ++i) {
+        CloseItemRepository(ir.shards[i]);
+    }
+    W::NotifyAll(ir.repo_not_full);
+    W::NotifyAll(ir.repo_not_empty);
+}
+
+template<typename T, std::size_t C, typename W>
+bool ShardedIsClosed(ShardedItemRepository<T, C, W>& ir) {
+    return MpmcIsClosed(ir.shards[0]);
+}
+
+template<typename T, std::size_t C, typename W>
+bool ShardedHasFreeSlot(ShardedItemRepository<T, C, W>& ir) {
+    for(std::size_t i = 0; i < ir.shard_count; ++i) {
+        if(MpmcHasFreeSlot(ir.shards[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T, std::size_t C, typename W>
+bool ShardedHasItem(ShardedItemRepository<T, C, W>& ir) {
+    for(std::size_t i = 0; i < ir.shard_count; ++i) {
+        if(MpmcHasItem(ir.shards[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T, std::size_t C, typename W>
+bool ShardedIsDrained(ShardedItemRepository<T, C, W>& ir) {
+    for(std::size_t i = 0; i < ir.shard_count; ++i) {
+        if(!MpmcIsDrained(ir.shards[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 非阻塞生产：从本线程的轮转位置开始，放入第一个有空闲槽位的分片。
+// 所有分片都满或已关闭时返回false(item不会被移动)
+template<typename T, std::size_t C, typename W, typename U>
+bool TryProduceItem(ShardedItemRepository<T, C, W>& ir, U&& item) {
+    thread_local std::size_t cursor = ThisThreadShardHint();
+    for(std::size_t i = 0; i < ir.shard_count; ++i) {
+        std::size_t shard = cursor++ % ir.shard_count;
+        if(TryProduceItem(ir.shards[shard], std::forward<U>(item))) {
+            W::Notify(ir.repo_not_empty);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 阻塞生产，产品库已关闭时返回kClosed
+template<typename T, std::size_t C, typename W, typename U>
+ProduceStatus ProduceItem(ShardedItemRepository<T, C, W>& ir, U&& item) {
+    while(!TryProduceItem(ir, std::forward<U>(item))) {
+        if(ShardedIsClosed(ir)) {
+            return ProduceStatus::kClosed;
+        }
+        // 所有分片都满，等待任意一个分片有空闲槽位
+        W::WaitFor(ir.repo_not_full, [&ir] { return ShardedHasFreeSlot(ir) || ShardedIsClosed(ir); });
+    }
+    return ProduceStatus::kOk;
+}
+
+// 按key的哈希选择分片，同一个key的产品总是进入同一个分片。产品库已关闭时返回kClosed
+template<typename T, std::size_t C, typename W, typename K, typename U>
+ProduceStatus ProduceItemByKey(ShardedItemRepository<T, C, W>& ir, const K& key, U&& item) {
+    typename ShardedItemRepository<T, C, W>::Shard& shard = ir.shards[std::hash<K>()(key) % ir.shard_count];
+    while(!TryProduceItem(shard, std::forward<U>(item))) {
+        if(MpmcIsClosed(shard)) {
+            return ProduceStatus::kClosed;
+        }
+        W::WaitFor(ir.repo_not_full, [&shard] { return MpmcHasFreeSlot(shard) || MpmcIsClosed(shard); });
+    }
+    W::Notify(ir.repo_not_empty);
+    return ProduceStatus::kOk;
+}
+
+/*
+本线程在ir上的主分片。第一次在ir上消费时从ir.next_home领取，之后从线程局部的小缓存中取。
+缓存按产品库地址查找，满了就轮流替换；被替换掉的产品库下次会领取一个新的主分片，仍然是轮流分配的。
+*/
+template<typename T, std::size_t C, typename W>
+std::size_t ShardedHomeShard(ShardedItemRepository<T, C, W>& ir) {
+    static const int kHomeCacheSize = 4;
+    struct HomeEntry {
+        const void* repo = nullptr;
+        std::size_t home = 0;
+    };
+    thread_local HomeEntry cache[kHomeCacheSize];
+    thread_local int victim = 0;
+    for(HomeEntry& entry : cache) {
+        if(entry.repo == &ir) {
+            return entry.home;
+        }
+    }
+    HomeEntry& entry = cache[victim];
+    victim = (victim + 1) % kHomeCacheSize;
+    entry.repo = &ir;
+    entry.home = ir.next_home.fetch_add(1, std::memory_order_relaxed) % ir.shard_count;
+    return entry.home;
+}
+
+// 槽位pos的产品已经取出，把槽位还给生产者。取之前分片是满的，才可能有生产者在等这个槽位
+template<typename T, std::size_t C, typename W>
+void ShardedReleaseCell(ShardedItemRepository<T, C, W>& ir,
+                        typename ShardedItemRepository<T, C, W>::Shard& shard,
+                        MpmcCell<T>* cell, std::size_t pos) {
+    cell->sequence.store(pos + shard.kCapacity, std::memory_order_release);
+    // 与等待者登记之后的栅栏配对：要么这里看到了已经推进到pos + kCapacity的write_position，
+    // 要么等待者重新检查时看到了这个槽位已经空闲
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::size_t wpos = shard.write_position.load(std::memory_order_relaxed) & ~shard.kClosedBit;
+    if(wpos - pos >= shard.kCapacity) {
+        W::NotifyAll(ir.repo_not_full);
+    }
+}
+
+// 非阻塞消费：先从本线程的主分片取，主分片空了就从其他分片窃取
+template<typename T, std::size_t C, typename W>
+bool TryConsumeItem(ShardedItemRepository<T, C, W>& ir, T& item) {
+    std::size_t home = ShardedHomeShard(ir);
+    for(std::size_t i = 0; i < ir.shard_count; ++i) {
+        typename ShardedItemRepository<T, C, W>::Shard& shard = ir.shards[(home + i) % ir.shard_count];
+        std::size_t pos;
+        MpmcCell<T>* cell = MpmcClaimReadCell(shard, pos);
+        if(cell != nullptr) {
+            item = cell->slot.Take();
+            ShardedReleaseCell(ir, shard, cell, pos);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 取出一个产品，所有分片都空时阻塞。产品库关闭并且所有分片都已取完时返回false
+template<typename T, std::size_t C, typename W>
+bool ConsumeItem(ShardedItemRepository<T, C, W>& ir, T& item) {
+    while(!TryConsumeItem(ir, item)) {
+        if(ShardedIsDrained(ir)) {
+            return false;
+        }
+        W::WaitFor(ir.repo_not_empty, [&ir] { return ShardedHasItem(ir) || ShardedIsDrained(ir); });
+    }
+    if(ShardedIsClosed(ir)) {
+        // 关闭后可能有消费者在等待最后几个还没写完的产品，排空时要叫醒所有人
+        W::NotifyAll(ir.repo_not_empty);
+    }
+    return true;
+}
+
+// 取出一个产品，所有分片都空时阻塞。不检查关闭状态，关闭后请使用ConsumeItem(ir, item)
+template<typename T, std::size_t C, typename W>
+T ConsumeItem(ShardedItemRepository<T, C, W>& ir) {
+    std::size_t home = ShardedHomeShard(ir);
+    while(1) {
+        for(std::size_t i = 0; i < ir.shard_count; ++i) {
+            typename ShardedItemRepository<T, C, W>::Shard& shard = ir.shards[(home + i) % ir.shard_count];
+            // 直接占有槽位并移出产品，这样T不需要默认构造函数
+            std::size_t pos;
+            MpmcCell<T>* cell = MpmcClaimReadCell(shard, pos);
+            if(cell != nullptr) {
+                T data = cell->slot.Take();
+                ShardedReleaseCell(ir, shard, cell, pos);
+                return data;
+            }
+        }
+        W::WaitFor(ir.repo_not_empty, [&ir] { return ShardedHasItem(ir); });
+    }
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef SHARED_MUTEX_H
+#define SHARED_MUTEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "cache_line.h"
+#include "hybrid_mutex.h"
+#include "item_slot.h"
+#include "thread_hint.h"
+#include "wait_point.h"
+#include "wait_strategy.h"
+
+/*
+写者优先、读者分散计数的读写锁
+
+chapter4_2.cpp、chapter5_1.cpp的共享数据，以及item16.cpp中Polynomial1::roots这样的缓存，
+读远多于写，但都用独占锁保护，读者之间也互相排队。
+std::shared_mutex允许多个读者同时持有锁，但所有读者仍然要在同一个计数器上做原子的读-改-写，
+读者越多，这个cache line在核之间来回传递得越厉害。SharedMutex把读者计数拆到多个条带上：
+1. 读者按ThisThreadShardHint在自己的条带上加一，再检查writers：没有写者就拿到了读锁；
+   有写者(正在写或者在排队)就把自己的计数减回去，等写者全部结束再重试。
+   没有写者时，读者之间不写任何共享的cache line。
+2. 写者先把writers加一(之后到来的读者都会让路，因此是写者优先)，
+   再在写者之间的互斥量(HybridMutex)上排队，拿到后等所有条带的读者计数归零。
+读者先写自己的条带再读writers，写者先写writers再读条带，两边都用seq_cst，
+和WaitPoint一样是Dekker式的同步：要么读者看到了写者，要么写者看到了读者，不会两边都错过。
+
+满足SharedMutex的要求，可以配合std::shared_lock和std::unique_lock使用。
+读锁必须由加锁的线程释放(和std::shared_mutex相同)，因为线程根据自己的编号找到条带。
+*/
+class SharedMutex {
+public:
+    explicit SharedMutex(std::size_t stripes = std::thread::hardware_concurrency())
+        : mask(RoundUpPowerOfTwo(stripes == 0 ? 1 : stripes) - 1),
+          readers(new ReaderStripe[mask + 1]) {}
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator=(const SharedMutex&) = delete;
+
+    void lock_shared() {
+        std::atomic<int32_t>& count = readers[ThisThreadShardHint() & mask].count;
+        while(!TryEnterShared(count)) {
+            SpinThenParkWait::WaitFor(no_writers, [this] {
+                return writers.load(std::memory_order_acquire) == 0;
+            });
+        }
+    }
+
+    bool try_lock_shared() {
+        return TryEnterShared(readers[ThisThreadShardHint() & mask].count);
+    }
+
+    void unlock_shared() {
+        readers[ThisThreadShardHint() & mask].count.fetch_sub(1, std::memory_order_seq_cst);
+        if(writers.load(std::memory_order_seq_cst) != 0) {
+            SpinThenParkWait::Notify(readers_drained);
+        }
+    }
+
+    void lock() {
+        writers.fetch_add(1, std::memory_order_seq_cst);
+        writer_mtx.lock();
+        SpinThenParkWait::WaitFor(readers_drained, [this] { return NoReaders(); });
+    }
+
+    bool try_lock() {
+        writers.fetch_add(1, std::memory_order_seq_cst);
+        if(writer_mtx.try_lock()) {
+            if(NoReaders()) {
+                return true;
+            }
+            writer_mtx.unlock();
+        }
+        LeaveWriter();
+        return false;
+    }
+
+    void unlock() {
+        writer_mtx.unlock();
+        LeaveWriter();
+    }
+
+private:
+    struct alignas(kCacheLineSize) ReaderStripe {
+        std::atomic<int32_t> count{0};
+    };
+
+    bool TryEnterShared(std::atomic<int32_t>& count) {
+        count.fetch_add(1, std::memory_order_seq_cst);
+        if(writers.load(std::memory_order_seq_cst) == 0) {
+            return true;
+        }
+        // 有写者，让路
+        count.fetch_sub(1, std::memory_order_seq_cst);
+        SpinThenParkWait::Notify(readers_drained);
+        return false;
+    }
+
+    bool NoReaders() const {
+        for(std::size_t i = 0; i <= mask; ++i) {
+            if(readers[i].count.load(std::memory_order_seq_cst) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void LeaveWriter() {
+        if(writers.fetch_sub(1, std::memory_order_release) == 1) {
+            SpinThenParkWait::NotifyAll(no_writers);
+        }
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<ReaderStripe[]> readers;
+    // 正在写或等待写的写者数
+    alignas(kCacheLineSize) std::atomic<uint32_t> writers{0};
+    HybridMutex writer_mtx;
+    alignas(kCacheLineSize) SpinThenParkWait::WaitPoint no_writers;
+    alignas(kCacheLineSize) SpinThenParkWait::WaitPoint readers_drained;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef SHM_ITEM_REPOSITORY_H
+#define SHM_ITEM_REPOSITORY_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache_line.h"
+#include "mpmc_item_repository.h"
+#include "spsc_item_repository.h"
+#include "wait_strategy.h"
+
+/*
+跨进程共享内存版ItemRepository
+
+生产者和消费者出于故障隔离运行在不同的进程中时，gItemRepository这样的全局变量无法共享，
+只能通过socket/管道传递序列化后的产品，每个产品至少被拷贝两次并进入内核两次。
+这里把整个无锁ItemRepository(环形缓冲区、读写位置、等待点)放进shm_open/mmap映射的共享内存：
+1. 创建方(ShmItemRepository::Create)用O_CREAT | O_EXCL创建共享内存对象，设置大小，
+   在映射的地址上原地构造ItemRepository，最后把头部的state置为就绪。
+2. 其他进程(ShmItemRepository::Open)按名字打开同一个对象，等到state就绪后直接使用。
+3. 之后两边调用的仍然是ProduceItem/ConsumeItem这些函数，产品直接写进对方也映射着的槽位，不需要序列化。
+
+能放进共享内存的ItemRepository需要满足：
+- 只包含位置无关的状态：SpscItemRepository和MpmcItemRepository只有下标和原子变量，
+  ItemRepository的std::mutex/std::condition_variable和ShardedItemRepository的堆内存都不行。
+- T可平凡拷贝(trivially copyable)，并且不含指针：指针在另一个进程的地址空间中没有意义。
+- 等待点使用不带FUTEX_PRIVATE_FLAG的futex，即ProcessSharedSpinThenParkWait等策略(见wait_strategy.h)。
+  ShmSpscItemRepository和ShmMpmcItemRepository是满足这些条件的别名。
+
+进程内的原子变量必须是无锁的(lock-free)才在共享内存中有效，这一点在编译期检查。
+某个进程在持有槽位时崩溃不会被检测，这里只提供进程间的数据通道，不做故障恢复。
+
+创建方的ShmItemRepository析构时析构ItemRepository并shm_unlink，其他进程析构时只解除映射。
+上次运行异常退出留下的同名对象会让Create失败(EEXIST)，可以先调用ShmItemRepository::Unlink清理。
+*/
+template<typename T, std::size_t Capacity = 1024, typename WaitStrategy = ProcessSharedSpinThenParkWait>
+using ShmSpscItemRepository = SpscItemRepository<T, Capacity, WaitStrategy>;
+
+template<typename T, std::size_t Capacity = 1024, typename WaitStrategy = ProcessSharedSpinThenParkWait>
+using ShmMpmcItemRepository = MpmcItemRepository<T, Capacity, WaitStrategy>;
+
+// 检查T和等待策略能否放进共享内存
+template<typename T, typename W>
+struct ShmCompatibleItem
+    : std::integral_constant<bool, std::is_trivially_copyable<T>::value
+                                   && !std::is_same<typename W::WaitPoint, WaitPoint>::value> {};
+
+// 检查ItemRepository能否放进共享内存。只列出已知位置无关的实现，
+// 其余的(包括同样是<T, Capacity, WaitStrategy>形式、却持有堆内存的ShardedItemRepository)一律拒绝
+template<typename Repository>
+struct ShmCompatible : std::false_type {};
+
+template<typename T, std::size_t C, typename W>
+struct ShmCompatible<SpscItemRepository<T, C, W>> : ShmCompatibleItem<T, W> {};
+
+template<typename T, std::size_t C, typename W>
+struct ShmCompatible<MpmcItemRepository<T, C, W>> : ShmCompatibleItem<T, W> {};
+
+template<typename Repository>
+class ShmItemRepository {
+public:
+    static_assert(ShmCompatible<Repository>::value,
+                  "shared memory needs a lock-free repository over a trivially copyable T "
+                  "with a process-shared wait strategy");
+    static_assert(std::atomic<std::size_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "atomics in shared memory must be lock-free");
+
+    // 创建共享内存对象name(形如"/item_repository")并在其中构造ItemRepository
+    static ShmItemRepository Create(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if(fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        if(ftruncate(fd, kMappingSize) != 0) {
+            int error = errno;
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+        }
+        ShmItemRepository shm(name, Map(fd, name), true);
+        ::new(static_cast<void*>(&shm.mapping->repository)) Repository();
+        shm.mapping->repository_size = sizeof(Repository);
+        shm.mapping->state.store(kReady, std::memory_order_release);
+        return shm;
+    }
+
+    // 打开其他进程创建的ItemRepository，最多等待timeout让创建方完成初始化
+    static ShmItemRepository Open(const std::string& name,
+                                  std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if(fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        // 创建方可能还没有设置大小
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        struct stat st;
+        while(fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) < kMappingSize) {
+            if(std::chrono::steady_clock::now() >= deadline) {
+                close(fd);
+                throw std::system_error(ETIMEDOUT, std::generic_category(), "shm size " + name);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ShmItemRepository shm(name, Map(fd, name), false);
+        while(shm.mapping->state.load(std::memory_order_acquire) != kReady) {
+            if(std::chrono::steady_clock::now() >= deadline) {
+                throw std::system_error(ETIMEDOUT, std::generic_category(), "shm init " + name);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // 两边的ItemRepository类型(T、容量)必须一致
+        if(shm.mapping->repository_size != sizeof(Repository)) {
+            throw std::system_error(EINVAL, std::generic_category(), "shm layout mismatch " + name);
+        }
+        return shm;
+    }
+
+    // 删除同名的共享内存对象，已经映射它的进程不受影响
+    static void Unlink(const std::string& name) {
+        shm_unlink(name.c_str());
+    }
+
+    ShmItemRepository(ShmItemRepository&& other) noexcept
+        : name(std::move(other.name)), mapping(std::exchange(other.mapping, nullptr)), owner(other.owner) {}
+    ShmItemRepository& operator=(ShmItemRepository&&) = delete;
+    ShmItemRepository(const ShmItemRepository&) = delete;
+    ShmItemRepository& operator=(const ShmItemRepository&) = delete;
+    ~ShmItemRepository() {
+        if(mapping == nullptr) {
+            return;
+        }
+        if(owner) {
+            mapping->repository.~Repository();
+            shm_unlink(name.c_str());
+        }
+        munmap(mapping, kMappingSize);
+    }
+
+    Repository& operator*() {
+        return mapping->repository;
+    }
+    Repository* operator->() {
+        return &mapping->repository;
+    }
+
+private:
+    static const uint32_t kReady = 0x52455059; // "REPY"
+
+    // 共享内存的布局：头部 + ItemRepository
+    struct Mapping {
+        std::atomic<uint32_t> state;
+        std::size_t repository_size;
+        alignas(kCacheLineSize) Repository repository;
+    };
+    static constexpr std::size_t kMappingSize = sizeof(Mapping);
+
+    static Mapping* Map(int fd, const std::string& name) {
+        void* addr = mmap(nullptr, kMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if(addr == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), "mmap " + name);
+        }
+        // ftruncate得到的新内存全为0，state为0表示还没有初始化完成
+        return static_cast<Mapping*>(addr);
+    }
+
+    ShmItemRepository(std::string name, Mapping* mapping, bool owner)
+        : name(std::move(name)), mapping(mapping), owner(owner) {}
+
+    std::string name;
+    Mapping* mapping;
+    bool owner;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include "cache_line.h"
+#include "wait_strategy.h"
+
+/*
+自旋锁：TAS、TTAS、排队的ticket锁和MCS锁
+
+chapter7_1.cpp的append_number用std::atomic_flag做自旋锁(TasSpinlock)，有两个问题：
+1. 所有等待者都在同一个cache line上反复test_and_set，每次都是一次读-改-写，
+   cache line在等待者之间来回抢夺，持有者释放锁时也要先把它抢回来。
+2. 不公平：谁的test_and_set碰巧先执行谁就拿到锁，高负载时某些线程可能一直抢不到。
+
+- TtasSpinlock: 先只读地等待锁变为空闲，看到空闲才去exchange(test-and-test-and-set)。
+  等待期间cache line处于共享状态，读不会产生总线流量；但释放时所有等待者仍然同时去抢。
+- TicketSpinlock: 取号排队。lock时在next_ticket上fetch_add领一个号，等now_serving等于这个号；
+  unlock把now_serving加一。严格先来先服务，每次加锁只有一次读-改-写；
+  但所有等待者读同一个now_serving，每次释放都会让所有等待者的cache line失效。
+- McsSpinlock: 等待者组成链表，每个等待者只在自己节点的flag上自旋，
+  释放时只写下一个等待者的节点。先来先服务，并且每次交接只影响一个等待者的cache line，
+  等待者再多，每次加锁/解锁的cache line流量也是常数。
+
+所有锁都满足Lockable，可以用于std::lock_guard。
+自旋kWaitSpinCount次(见wait_strategy.h)仍然等不到时改为yield：持有者(或排在前面的等待者)
+被调度出去时，继续自旋只是浪费它需要的CPU时间。
+*/
+
+// 自旋等待的退避：先pause，再yield
+inline void SpinBackoff(int& spins) {
+    if(spins < kWaitSpinCount) {
+        ++spins;
+        CpuRelax();
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+class TasSpinlock {
+public:
+    void lock() {
+        int spins = 0;
+        while(flag.test_and_set(std::memory_order_acquire)) {
+            SpinBackoff(spins);
+        }
+    }
+    bool try_lock() {
+        return !flag.test_and_set(std::memory_order_acquire);
+    }
+    void unlock() {
+        flag.clear(std::memory_order_release);
+    }
+
+private:
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+};
+
+class TtasSpinlock {
+public:
+    void lock() {
+        int spins = 0;
+        while(1) {
+            if(!locked.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            // 只读地等待，直到锁看起来空闲
+            while(locked.load(std::memory_order_relaxed)) {
+                SpinBackoff(spins);
+            }
+        }
+    }
+    bool try_lock() {
+        return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+    }
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> locked{false};
+};
+
+class TicketSpinlock {
+public:
+    void lock() {
+        uint32_t ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+        int spins = 0;
+        while(now_serving.load(std::memory_order_acquire) != ticket) {
+            SpinBackoff(spins);
+        }
+    }
+    bool try_lock() {
+        uint32_t serving = now_serving.load(std::memory_order_relaxed);
+        uint32_t ticket = serving;
+        // 只有没人排队(next_ticket == now_serving)时才领号
+        return next_ticket.compare_exchange_strong(ticket, serving + 1, std::memory_order_acquire,
+                                                   std::memory_order_relaxed);
+    }
+    void unlock() {
+        // 只有持有者会写now_serving
+        now_serving.store(now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    // 领号和叫号分开放置，领号的线程不会干扰正在读now_serving的等待者
+    alignas(kCacheLineSize) std::atomic<uint32_t> next_ticket{0};
+    alignas(kCacheLineSize) std::atomic<uint32_t> now_serving{0};
+};
+
+/*
+MCS锁的等待节点放在每个线程自己的线程局部节点池中，支持同一个线程同时持有多把MCS锁
+(最多kMcsMaxNesting把)，因此lock/unlock不需要调用者传入节点，可以用于std::lock_guard。
+节点池用一个位图记录哪些节点正在使用，unlock归还的是这把锁自己的节点(owner)，而不是最后分配的节点，
+因此释放顺序不受限制：std::lock可能按轮转后的顺序上锁，两个unique_lock析构时再乱序释放，也不会破坏队列。
+同时持有超过kMcsMaxNesting把MCS锁时调用std::abort。
+*/
+static const int kMcsMaxNesting = 16;
+
+class McsSpinlock {
+public:
+    struct alignas(kCacheLineSize) Node {
+        std::atomic<Node*> next{nullptr};
+        std::atomic<bool> locked{false};
+    };
+
+    void lock() {
+        Node* node = AllocNode();
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->locked.store(true, std::memory_order_relaxed);
+        // 把自己挂到队尾，前面有人就在自己的节点上等待
+        Node* prev = tail.exchange(node, std::memory_order_acq_rel);
+        if(prev != nullptr) {
+            prev->next.store(node, std::memory_order_release);
+            int spins = 0;
+            while(node->locked.load(std::memory_order_acquire)) {
+                SpinBackoff(spins);
+            }
+        }
+        owner = node;
+    }
+
+    bool try_lock() {
+        Node* node = AllocNode();
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* expected = nullptr;
+        if(tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed)) {
+            owner = node;
+            return true;
+        }
+        FreeNode(node);
+        return false;
+    }
+
+    void unlock() {
+        Node* node = owner;
+        Node* next = node->next.load(std::memory_order_acquire);
+        if(next == nullptr) {
+            // 没有后继，尝试把队列清空
+            Node* expected = node;
+            if(tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+                FreeNode(node);
+                return;
+            }
+            // 有线程正在入队，等它把自己挂到node->next上
+            int spins = 0;
+            while((next = node->next.load(std::memory_order_acquire)) == nullptr) {
+                SpinBackoff(spins);
+            }
+        }
+        // 只写后继节点的cache line，把锁交给它
+        next->locked.store(false, std::memory_order_release);
+        FreeNode(node);
+    }
+
+private:
+    struct NodePool {
+        Node nodes[kMcsMaxNesting];
+        uint32_t in_use = 0; // 第i位表示nodes[i]正在某把锁的队列中
+    };
+    static NodePool& ThisThreadNodes() {
+        thread_local NodePool pool;
+        return pool;
+    }
+    static Node* AllocNode() {
+        NodePool& pool = ThisThreadNodes();
+        uint32_t free = ~pool.in_use & ((uint32_t(1) << kMcsMaxNesting) - 1);
+        if(free == 0) {
+            std::abort();
+        }
+        int index = __builtin_ctz(free);
+        pool.in_use |= uint32_t(1) << index;
+        return &pool.nodes[index];
+    }
+    // 归还node，不要求是最后分配的节点
+    static void FreeNode(Node* node) {
+        NodePool& pool = ThisThreadNodes();
+        pool.in_use &= ~(uint32_t(1) << (node - pool.nodes));
+    }
+
+    alignas(kCacheLineSize) std::atomic<Node*> tail{nullptr};
+    // 持有者的节点，只有持有者会读写
+    Node* owner = nullptr;
+};
+
+#endif
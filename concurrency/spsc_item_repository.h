@@ -0,0 +1,161 @@
+#ifndef SPSC_ITEM_REPOSITORY_H
+#define SPSC_ITEM_REPOSITORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "cache_line.h"
+#include "item_slot.h"
+#include "wait_strategy.h"
+
+/*
+单生产者单消费者(SPSC)的无锁环形队列版ItemRepository
+
+ProducerAndComsumer1.cpp中每生产/消费一个产品都要加锁并notify条件变量，
+但只有一个生产者和一个消费者时，write_position只被生产者修改，
+read_position只被消费者修改，因此不需要互斥量：
+1. 生产者先写入产品，再以release语义发布write_position；
+   消费者以acquire语义读取write_position，就一定能看到已经写入的产品。
+2. 消费者读出产品后，再以release语义发布read_position；
+   生产者以acquire语义读取read_position，就知道哪些槽位可以复用。
+
+read_position和write_position是单调递增的计数器(不回绕)，
+下标为position & kMask(容量被向上取整为2的幂)，
+write_position - read_position即为当前产品数，因此所有槽位都能用上。
+
+两个位置分别放在独立的cache line上，避免生产者和消费者互相使对方的cache line失效(伪共享)。
+另外每一方都缓存一份对方的位置，只有在缓存值显示"满"或"空"时才去读取真正的原子变量。
+
+产品在槽位上原地构造、移动取出，T可以是只能移动的类型。
+
+只有在缓冲区真的满或者空时才需要等待，等待方式由WaitStrategy决定(见wait_strategy.h)，
+默认先自旋，仍然等不到才在futex上睡眠。
+*/
+template<typename T, std::size_t Capacity = 1024, typename WaitStrategy = SpinThenParkWait>
+class SpscItemRepository {
+public:
+    static constexpr std::size_t kCapacity = RoundUpPowerOfTwo(Capacity);
+    static constexpr std::size_t kMask = kCapacity - 1;
+
+    SpscItemRepository() = default;
+    SpscItemRepository(const SpscItemRepository&) = delete;
+    SpscItemRepository& operator=(const SpscItemRepository&) = delete;
+    ~SpscItemRepository() {
+        // 析构没有被取走的产品
+        std::size_t wpos = write_position.load(std::memory_order_relaxed);
+        for(std::size_t rpos = read_position.load(std::memory_order_relaxed); rpos != wpos; ++rpos) {
+            item_buffer[rpos & kMask].Destroy();
+        }
+    }
+
+    // 生产者独占的cache line
+    alignas(kCacheLineSize) std::atomic<std::size_t> write_position{0};
+    // 生产者缓存的read_position
+    std::size_t cached_read_position = 0;
+
+    // 消费者独占的cache line
+    alignas(kCacheLineSize) std::atomic<std::size_t> read_position{0};
+    // 消费者缓存的write_position
+    std::size_t cached_write_position = 0;
+
+    // 指示产品缓冲区不为满/不为空的等待点
+    alignas(kCacheLineSize) typename WaitStrategy::WaitPoint repo_not_full;
+    alignas(kCacheLineSize) typename WaitStrategy::WaitPoint repo_not_empty;
+
+    // 产品缓冲区
+    alignas(kCacheLineSize) ItemSlot<T> item_buffer[kCapacity];
+};
+
+// 清空产品库，析构剩余的产品。调用时不能有生产者和消费者在运行
+template<typename T, std::size_t C, typename W>
+void InitItemRepository(SpscItemRepository<T, C, W>& ir) {
+    std::size_t wpos = ir.write_position.load(std::memory_order_relaxed);
+    for(std::size_t rpos = ir.read_position.load(std::memory_order_relaxed); rpos != wpos; ++rpos) {
+        ir.item_buffer[rpos & ir.kMask].Destroy();
+    }
+    ir.read_position.store(0, std::memory_order_relaxed);
+    ir.write_position.store(0, std::memory_order_relaxed);
+    ir.cached_read_position = 0;
+    ir.cached_write_position = 0;
+}
+
+// 非阻塞生产，在槽位上用args原地构造产品，缓冲区满时返回false(args不会被移动)
+template<typename T, std::size_t C, typename W, typename... Args>
+bool TryEmplaceItem(SpscItemRepository<T, C, W>& ir, Args&&... args) {
+    std::size_t wpos = ir.write_position.load(std::memory_order_relaxed);
+    if(wpos - ir.cached_read_position == ir.kCapacity) {
+        ir.cached_read_position = ir.read_position.load(std::memory_order_acquire);
+        if(wpos - ir.cached_read_position == ir.kCapacity) {
+            return false;
+        }
+    }
+    ir.item_buffer[wpos & ir.kMask].Emplace(std::forward<Args>(args)...);
+    ir.write_position.store(wpos + 1, std::memory_order_release);
+    W::Notify(ir.repo_not_empty);
+    return true;
+}
+
+template<typename T, std::size_t C, typename W, typename U>
+bool TryProduceItem(SpscItemRepository<T, C, W>& ir, U&& item) {
+    return TryEmplaceItem(ir, std::forward<U>(item));
+}
+
+// 非阻塞消费，缓冲区空时返回false
+template<typename T, std::size_t C, typename W>
+bool TryConsumeItem(SpscItemRepository<T, C, W>& ir, T& item) {
+    std::size_t rpos = ir.read_position.load(std::memory_order_relaxed);
+    if(rpos == ir.cached_write_position) {
+        ir.cached_write_position = ir.write_position.load(std::memory_order_acquire);
+        if(rpos == ir.cached_write_position) {
+            return false;
+        }
+    }
+    item = ir.item_buffer[rpos & ir.kMask].Take();
+    ir.read_position.store(rpos + 1, std::memory_order_release);
+    W::Notify(ir.repo_not_full);
+    return true;
+}
+
+template<typename T, std::size_t C, typename W>
+bool SpscHasFreeSlot(SpscItemRepository<T, C, W>& ir) {
+    return ir.write_position.load(std::memory_order_relaxed)
+            - ir.read_position.load(std::memory_order_acquire) < ir.kCapacity;
+}
+
+template<typename T, std::size_t C, typename W>
+bool SpscHasItem(SpscItemRepository<T, C, W>& ir) {
+    return ir.read_position.load(std::memory_order_relaxed)
+            != ir.write_position.load(std::memory_order_acquire);
+}
+
+// 阻塞生产。SPSC版本没有关闭状态，总是返回kOk
+template<typename T, std::size_t C, typename W, typename... Args>
+ProduceStatus EmplaceItem(SpscItemRepository<T, C, W>& ir, Args&&... args) {
+    while(!TryEmplaceItem(ir, std::forward<Args>(args)...)) {
+        // 生产者需要等待产品缓冲区不为满
+        W::WaitFor(ir.repo_not_full, [&ir] { return SpscHasFreeSlot(ir); });
+    }
+    return ProduceStatus::kOk;
+}
+
+template<typename T, std::size_t C, typename W, typename U>
+ProduceStatus ProduceItem(SpscItemRepository<T, C, W>& ir, U&& item) {
+    return EmplaceItem(ir, std::forward<U>(item));
+}
+
+template<typename T, std::size_t C, typename W>
+T ConsumeItem(SpscItemRepository<T, C, W>& ir) {
+    // 只有一个消费者，确认有产品后直接从槽位中移出，不需要默认构造T
+    while(!SpscHasItem(ir)) {
+        // 消费者等待生产者生产产品
+        W::WaitFor(ir.repo_not_empty, [&ir] { return SpscHasItem(ir); });
+    }
+    std::size_t rpos = ir.read_position.load(std::memory_order_relaxed);
+    T data = ir.item_buffer[rpos & ir.kMask].Take();
+    ir.read_position.store(rpos + 1, std::memory_order_release);
+    W::Notify(ir.repo_not_full);
+    return data;
+}
+
+#endif
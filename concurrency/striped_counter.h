@@ -0,0 +1,134 @@
+#ifndef STRIPED_COUNTER_H
+#define STRIPED_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "cache_line.h"
+#include "item_slot.h"
+#include "thread_hint.h"
+
+/*
+分条(striped)计数器
+
+chapter4_1.cpp中的Counter::increment先锁住recursive_mutex，再通过add()重入一次，
+每次加一要做两次上锁/解锁，并且所有线程都在写同一个cache line。
+请求数、指标这类每个核都在累加、偶尔才读取的计数器，可以把值拆到多个条带(stripe)上：
+1. 每个条带独占一个cache line，线程按ThisThreadShardHint选择自己的条带，
+   Add只是在自己的条带上做一次relaxed的fetch_add，线程数不超过条带数时不同线程之间没有任何共享的写。
+2. 读取时把所有条带加起来：
+   - ReadApproximate: 逐个relaxed读取后求和。并发写入时，结果可能不是计数器在任何时刻真正有过的值，
+     但每个已完成的Add迟早都会被计入，适合监控这类只看趋势的读取。
+   - ReadExact: 连续两遍读取所有条带，直到两遍读到的每个条带都相同。
+     结果是两遍之间某一时刻所有条带的值之和，对只增不减的计数器，就是计数器在那一时刻的精确值。
+     没有并发写入时一遍就能确认。多核上写入很频繁时两遍可能一直对不上，
+     因此最多重试kExactReadRetries次，之后改为冻结所有条带：
+     读者用fetch_or给每个条带置上kFrozenBit，拿到的就是该条带冻结时的值；
+     冻结后的Add从fetch_add的返回值看到冻结位，就等到读者解冻后再返回，
+     这样的加法算作在解冻时才生效，不属于读者的快照。
+     所有条带都冻结的那一刻，各条带冻结时的值之和就是计数器在那一刻的精确值。
+     冻结只在读者放弃两遍读取时发生，Add的快路径只多检查一次fetch_add的返回值。
+计数器只能增加：Add的参数必须非负(负数会调用std::abort)。
+两遍读取判断"没有变化"依赖单调性，冻结位也占用了值的最高有效位。
+条带数默认取CPU核数向上取整到2的幂，最多kMaxStripes个，ReadExact因此可以把上一遍的值放在栈上，读取时不分配内存。
+*/
+class StripedCounter {
+public:
+    explicit StripedCounter(std::size_t stripes = std::thread::hardware_concurrency())
+        : mask(RoundUpPowerOfTwo(stripes == 0 ? 1 : (stripes > kMaxStripes ? kMaxStripes : stripes)) - 1),
+          stripes(new Stripe[mask + 1]) {}
+    StripedCounter(const StripedCounter&) = delete;
+    StripedCounter& operator=(const StripedCounter&) = delete;
+
+    void Add(int64_t n) {
+        if(n < 0) {
+            std::abort();
+        }
+        std::atomic<int64_t>& value = stripes[ThisThreadShardHint() & mask].value;
+        if(value.fetch_add(n, std::memory_order_relaxed) & kFrozenBit) {
+            // 有读者正在冻结读取，这次加法要到解冻时才生效，在此之前不能返回
+            while(value.load(std::memory_order_acquire) & kFrozenBit) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    void Increment() {
+        Add(1);
+    }
+
+    int64_t ReadApproximate() const {
+        int64_t sum = 0;
+        for(std::size_t i = 0; i <= mask; ++i) {
+            sum += stripes[i].value.load(std::memory_order_relaxed) & ~kFrozenBit;
+        }
+        return sum;
+    }
+
+    int64_t ReadExact() const {
+        int64_t last[kMaxStripes];
+        for(std::size_t i = 0; i <= mask; ++i) {
+            last[i] = stripes[i].value.load(std::memory_order_acquire);
+        }
+        for(int retry = 0; retry < kExactReadRetries; ++retry) {
+            bool stable = true;
+            int64_t sum = 0;
+            for(std::size_t i = 0; i <= mask; ++i) {
+                int64_t value = stripes[i].value.load(std::memory_order_acquire);
+                // 冻结期间的值含有还没生效的加法，不能当作稳定的值
+                if(value != last[i] || (value & kFrozenBit)) {
+                    stable = false;
+                    last[i] = value;
+                }
+                sum += value;
+            }
+            if(stable) {
+                return sum;
+            }
+        }
+        return ReadFrozen();
+    }
+
+    // 清零，调用时不能有并发的Add
+    void Reset() {
+        for(std::size_t i = 0; i <= mask; ++i) {
+            stripes[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t StripeCount() const {
+        return mask + 1;
+    }
+
+    static constexpr std::size_t kMaxStripes = 256;
+
+private:
+    static const int kExactReadRetries = 8;
+    static constexpr int64_t kFrozenBit = int64_t(1) << 62;
+
+    struct alignas(kCacheLineSize) Stripe {
+        std::atomic<int64_t> value{0};
+    };
+
+    // 冻结所有条带后求和，再全部解冻。freeze_mtx保证同一时刻只有一个读者在冻结
+    int64_t ReadFrozen() const {
+        std::lock_guard<std::mutex> lock(freeze_mtx);
+        int64_t sum = 0;
+        for(std::size_t i = 0; i <= mask; ++i) {
+            sum += stripes[i].value.fetch_or(kFrozenBit, std::memory_order_acq_rel);
+        }
+        for(std::size_t i = 0; i <= mask; ++i) {
+            stripes[i].value.fetch_and(~kFrozenBit, std::memory_order_release);
+        }
+        return sum;
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<Stripe[]> stripes;
+    mutable std::mutex freeze_mtx;
+};
+
+#endif
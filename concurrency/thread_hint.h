@@ -0,0 +1,18 @@
+#ifndef THREAD_HINT_H
+#define THREAD_HINT_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+线程编号提示：每个线程第一次调用时领取一个递增的编号，之后一直返回这个编号。
+分片的数据结构用它给线程选择"自己的"分片(编号 % 分片数)，
+相邻创建的线程落在不同的分片上，不需要哈希std::thread::id。
+*/
+inline std::size_t ThisThreadShardHint() {
+    static std::atomic<std::size_t> next_hint(0);
+    thread_local std::size_t hint = next_hint.fetch_add(1, std::memory_order_relaxed);
+    return hint;
+}
+
+#endif
@@ -0,0 +1,292 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "cache_line.h"
+#include "wait_strategy.h"
+
+/*
+带工作窃取(work stealing)的固定大小线程池
+
+chapter3.cpp和chapter4_1.cpp中每个任务都创建一个新的std::thread，
+任务很短时，创建和join线程的开销(几十微秒)远大于任务本身。
+线程池在构造时创建固定数量的工作线程，之后所有任务都在这些线程上运行：
+1. 每个工作线程有自己的任务队列(双端队列)。工作线程提交的任务放到自己队列的尾部，
+   自己也从尾部取任务(LIFO，刚提交的任务用到的数据还在cache中)。
+2. 自己的队列空了，就从其他工作线程队列的头部"窃取"任务(FIFO，偷走的往往是较大的任务)，
+   忙的线程的积压会被空闲线程分担。
+3. 非工作线程提交的任务轮流放进各个工作线程的队列。
+4. 所有队列都空时，工作线程按SpinThenParkWait先自旋、再在futex上睡眠(见wait_strategy.h)，
+   提交任务时只有存在睡眠的线程才会进入内核唤醒。
+
+每个队列旁边有一个非空提示(任务数)，只在持有该队列的互斥量时更新，和互斥量在同一个cache line上。
+窃取和判断是否要睡眠时只读这些提示，空队列不用加锁；提交和取任务不会写任何全局共享的变量，
+只有睡眠前后才会修改等待点中的等待者计数。
+
+每个队列由自己的互斥量保护：一个队列平时只有它的主人在用，互斥量几乎不会发生竞争，
+而无锁的Chase-Lev双端队列需要处理数组扩容和内存回收，这里不值得。
+
+submit返回std::future，任务抛出的异常在future.get()时重新抛出。
+在任务中等待另一个任务的future会占住一个工作线程，等待时请调用run_pending_task帮忙执行任务，
+parallel_for就是这样等待的，因此可以在任务中嵌套使用。
+
+析构时先执行完所有已提交的任务，再结束工作线程。
+*/
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t thread_count = std::thread::hardware_concurrency()) {
+        if(thread_count == 0) {
+            thread_count = 1;
+        }
+        for(std::size_t i = 0; i < thread_count; ++i) {
+            queues.emplace_back(new WorkQueue);
+        }
+        for(std::size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool() {
+        stopping.store(true, std::memory_order_release);
+        SpinThenParkWait::NotifyAll(work_available);
+        for(auto& th : threads) {
+            th.join();
+        }
+    }
+
+    std::size_t size() const {
+        return threads.size();
+    }
+
+    // 提交任务f(args...)，返回保存其结果的future
+    template<typename F, typename... Args>
+    auto submit(F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+        using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+        std::packaged_task<R()> task(
+            [f = std::forward<F>(f), tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                return std::apply(std::move(f), std::move(tuple));
+            });
+        std::future<R> result = task.get_future();
+        push(std::unique_ptr<TaskBase>(new Task<std::packaged_task<R()>>(std::move(task))));
+        return result;
+    }
+
+    // 提交不需要结果的任务f()，不创建future，可以作为LightFuture::then的执行器(见light_future.h)
+    template<typename F>
+    void execute(F&& f) {
+        push(std::unique_ptr<TaskBase>(new Task<std::decay_t<F>>(std::decay_t<F>(std::forward<F>(f)))));
+    }
+
+    // 在调用线程上执行一个等待中的任务，没有任务时返回false
+    bool run_pending_task() {
+        std::unique_ptr<TaskBase> task;
+        if(!pop_task(current_worker(), task)) {
+            return false;
+        }
+        task->run();
+        return true;
+    }
+
+private:
+    // 类型擦除的任务，和std::function不同，可以保存packaged_task这样只能移动的对象
+    struct TaskBase {
+        virtual ~TaskBase() = default;
+        virtual void run() = 0;
+    };
+    template<typename F>
+    struct Task : TaskBase {
+        explicit Task(F&& f) : f(std::move(f)) {}
+        void run() override {
+            f();
+        }
+        F f;
+    };
+
+    struct alignas(kCacheLineSize) WorkQueue {
+        std::mutex mtx;
+        // tasks.size()的副本，持有mtx时更新，其他线程不加锁地读它来跳过空队列
+        std::atomic<std::size_t> size{0};
+        std::deque<std::unique_ptr<TaskBase>> tasks;
+    };
+
+    // 当前线程在本线程池中的工作线程编号，不是本线程池的工作线程时为size()
+    std::size_t current_worker() const {
+        return current_pool() == this ? current_index() : threads.size();
+    }
+    static const ThreadPool*& current_pool() {
+        thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+    static std::size_t& current_index() {
+        thread_local std::size_t index = 0;
+        return index;
+    }
+
+    void push(std::unique_ptr<TaskBase> task) {
+        std::size_t index = current_worker();
+        if(index == threads.size()) {
+            index = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        }
+        {
+            WorkQueue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mtx);
+            queue.tasks.push_back(std::move(task));
+            queue.size.store(queue.tasks.size(), std::memory_order_release);
+        }
+        // 只有登记了等待者时才会进入内核；与等待者登记之后的栅栏配对，
+        // 要么这里看到了等待者，要么等待者重新检查时看到了上面的size
+        SpinThenParkWait::Notify(work_available);
+    }
+
+    // 是否有队列中还有任务
+    bool has_pending_task() const {
+        for(const auto& queue : queues) {
+            if(queue->size.load(std::memory_order_acquire) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 从queue中取一个任务，from_back为true时从尾部取，否则从头部窃取
+    static bool take_from(WorkQueue& queue, bool from_back, std::unique_ptr<TaskBase>& task) {
+        if(queue.size.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if(queue.tasks.empty()) {
+            return false;
+        }
+        if(from_back) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    // 先从自己队列的尾部取，再依次从其他队列的头部窃取
+    bool pop_task(std::size_t home, std::unique_ptr<TaskBase>& task) {
+        std::size_t start = 0;
+        std::size_t victims = queues.size();
+        if(home < queues.size()) {
+            if(take_from(*queues[home], true, task)) {
+                return true;
+            }
+            // 自己的队列已经看过了，只窃取其他size() - 1个队列
+            start = home + 1;
+            victims = queues.size() - 1;
+        }
+        for(std::size_t i = 0; i < victims; ++i) {
+            if(take_from(*queues[(start + i) % queues.size()], false, task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(std::size_t index) {
+        current_pool() = this;
+        current_index() = index;
+        std::unique_ptr<TaskBase> task;
+        while(1) {
+            if(pop_task(index, task)) {
+                task->run();
+                task.reset();
+                continue;
+            }
+            if(stopping.load(std::memory_order_acquire) && !has_pending_task()) {
+                break;
+            }
+            SpinThenParkWait::WaitFor(work_available, [this] {
+                return has_pending_task() || stopping.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> next_queue{0};
+    alignas(kCacheLineSize) std::atomic<bool> stopping{false};
+    alignas(kCacheLineSize) SpinThenParkWait::WaitPoint work_available;
+};
+
+/*
+把[first, last)切成若干块，在线程池上并行地对每个下标调用f(i)。
+grain是每块大约包含的下标数，为0时按线程数的4倍切块，让窃取有平衡负载的余地。
+最后一块在调用线程上执行，等待其他块时调用线程也帮忙执行任务，因此可以在任务中调用。
+f抛出的第一个异常会在所有块结束后重新抛出。
+*/
+template<typename Index, typename F>
+void parallel_for(ThreadPool& pool, Index first, Index last, F&& f, Index grain = 0) {
+    if(!(first < last)) {
+        return;
+    }
+    Index count = last - first;
+    Index chunks = static_cast<Index>(pool.size() * 4);
+    if(grain > 0) {
+        chunks = (count + grain - 1) / grain;
+    }
+    if(chunks > count) {
+        chunks = count;
+    }
+    if(chunks < 1) {
+        chunks = 1;
+    }
+    auto run_chunk = [&f](Index begin, Index end) {
+        for(Index i = begin; i < end; ++i) {
+            f(i);
+        }
+    };
+    std::vector<std::future<void>> futures;
+    futures.reserve(static_cast<std::size_t>(chunks));
+    Index begin = first;
+    for(Index c = 0; c < chunks - 1; ++c) {
+        Index end = begin + count / chunks + (c < count % chunks ? 1 : 0);
+        futures.push_back(pool.submit(run_chunk, begin, end));
+        begin = end;
+    }
+    std::exception_ptr error;
+    try {
+        run_chunk(begin, last);
+    } catch(...) {
+        error = std::current_exception();
+    }
+    for(auto& future : futures) {
+        while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if(!pool.run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+        try {
+            future.get();
+        } catch(...) {
+            if(!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef WAIT_POINT_H
+#define WAIT_POINT_H
+
+#include <atomic>
+#include <cstdint>
+#include "futex.h"
+
+/*
+无锁队列慢路径上的等待点
+
+等待者先把waiters加一(登记)，再重新检查条件，最后在seq上futex_wait；
+唤醒方修改完共享状态后，如果看到waiters不为0，就递增seq并futex_wake。
+
+两边的seq_cst栅栏保证：要么唤醒方看到了等待者的登记，
+要么等待者在登记之后的重新检查中看到了唤醒方的修改，不会两边同时错过(丢失唤醒)。
+没有等待者时，唤醒方只多付出一次栅栏和一次读，不会进入内核。
+
+ProcessSharedWaitPoint的状态完全相同，但使用不带FUTEX_PRIVATE_FLAG的futex，
+可以放在多个进程共享的内存中(见shm_item_repository.h)。
+*/
+struct WaitPoint {
+    static constexpr bool kProcessShared = false;
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> waiters{0};
+};
+
+struct ProcessSharedWaitPoint {
+    static constexpr bool kProcessShared = true;
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> waiters{0};
+};
+
+template<typename WP>
+void WaitPointNotify(WP& wp, int count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(wp.waiters.load(std::memory_order_relaxed) != 0) {
+        wp.seq.fetch_add(1, std::memory_order_release);
+        futex_wake(&wp.seq, count, WP::kProcessShared);
+    }
+}
+
+template<typename WP>
+void WaitPointNotifyOne(WP& wp) {
+    WaitPointNotify(wp, 1);
+}
+
+template<typename WP>
+void WaitPointNotifyAll(WP& wp) {
+    WaitPointNotify(wp, INT32_MAX);
+}
+
+// 在wp上等待，直到ready()为真
+template<typename WP, typename Pred>
+void WaitPointWaitFor(WP& wp, Pred ready) {
+    while(!ready()) {
+        uint32_t seq = wp.seq.load(std::memory_order_acquire);
+        wp.waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(!ready()) {
+            futex_wait(&wp.seq, seq, WP::kProcessShared);
+        }
+        wp.waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+#endif
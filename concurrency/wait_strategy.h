@@ -0,0 +1,123 @@
+#ifndef WAIT_STRATEGY_H
+#define WAIT_STRATEGY_H
+
+#include <thread>
+#include "wait_point.h"
+
+/*
+无锁ItemRepository在缓冲区满/空时的等待策略
+
+直接在futex(或条件变量)上睡眠要付出一次系统调用和一次上下文切换，
+而对方线程往往几微秒内就会跟上。不同部署对延迟和CPU占用的取舍不同，
+因此把等待方式做成ItemRepository的策略(policy)模板参数：
+1. BusySpinWait: 一直忙等，延迟最低，但等待期间独占一个CPU核心。
+2. SpinYieldWait: 先用pause指令自旋一段时间，再循环调用yield让出CPU，不进入睡眠。
+3. SpinThenParkWait: 先自旋、再yield，仍然等不到才在futex上睡眠(默认策略)。
+4. BlockingWait: 直接在futex上睡眠，CPU占用最低。
+
+每个策略提供：
+- WaitPoint: 等待点的状态，ItemRepository为"不为满"和"不为空"各持有一个。
+- WaitFor(wp, ready): 等待直到ready()为真。
+- Notify(wp): 状态改变后通知一个等待者。不会睡眠的策略Notify是空操作，
+  因此热路径上连一次栅栏都不用付出。
+- NotifyAll(wp): 通知所有等待者，用于关闭ItemRepository这类所有人都要重新检查条件的情况。
+
+会睡眠的两个策略以等待点类型为模板参数：SpinThenParkWait和BlockingWait使用进程内的WaitPoint，
+ProcessSharedSpinThenParkWait和ProcessSharedBlockingWait使用ProcessSharedWaitPoint，
+用于放在共享内存中、跨进程使用的ItemRepository。BusySpinWait和SpinYieldWait没有状态，两种场合都能用。
+*/
+
+// 自旋等待时提示CPU当前处于忙等循环，降低功耗，并避免退出循环时的流水线惩罚
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+static const int kWaitSpinCount = 128;  // pause自旋次数
+static const int kWaitYieldCount = 16;  // yield次数
+
+struct BusySpinWait {
+    struct WaitPoint {};
+
+    template<typename Pred>
+    static void WaitFor(WaitPoint&, Pred ready) {
+        while(!ready()) {
+            CpuRelax();
+        }
+    }
+    static void Notify(WaitPoint&) {}
+    static void NotifyAll(WaitPoint&) {}
+};
+
+struct SpinYieldWait {
+    struct WaitPoint {};
+
+    template<typename Pred>
+    static void WaitFor(WaitPoint&, Pred ready) {
+        for(int i = 0; i < kWaitSpinCount; ++i) {
+            if(ready()) {
+                return;
+            }
+            CpuRelax();
+        }
+        while(!ready()) {
+            std::this_thread::yield();
+        }
+    }
+    static void Notify(WaitPoint&) {}
+    static void NotifyAll(WaitPoint&) {}
+};
+
+template<typename WP>
+struct BasicSpinThenParkWait {
+    using WaitPoint = WP;
+
+    template<typename Pred>
+    static void WaitFor(WaitPoint& wp, Pred ready) {
+        for(int i = 0; i < kWaitSpinCount; ++i) {
+            if(ready()) {
+                return;
+            }
+            CpuRelax();
+        }
+        for(int i = 0; i < kWaitYieldCount; ++i) {
+            if(ready()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        WaitPointWaitFor(wp, ready);
+    }
+    static void Notify(WaitPoint& wp) {
+        WaitPointNotifyOne(wp);
+    }
+    static void NotifyAll(WaitPoint& wp) {
+        WaitPointNotifyAll(wp);
+    }
+};
+
+template<typename WP>
+struct BasicBlockingWait {
+    using WaitPoint = WP;
+
+    template<typename Pred>
+    static void WaitFor(WaitPoint& wp, Pred ready) {
+        WaitPointWaitFor(wp, ready);
+    }
+    static void Notify(WaitPoint& wp) {
+        WaitPointNotifyOne(wp);
+    }
+    static void NotifyAll(WaitPoint& wp) {
+        WaitPointNotifyAll(wp);
+    }
+};
+
+using SpinThenParkWait = BasicSpinThenParkWait<WaitPoint>;
+using BlockingWait = BasicBlockingWait<WaitPoint>;
+using ProcessSharedSpinThenParkWait = BasicSpinThenParkWait<ProcessSharedWaitPoint>;
+using ProcessSharedBlockingWait = BasicBlockingWait<ProcessSharedWaitPoint>;
+
+#endif
@@ -68,6 +68,7 @@ enum Color : std::uint8_t;
 #include <vector>
 #include <tuple>
 #include <type_traits>
+#include "concurrency/factorizer.h"
 
 // 前置声明
 // enum Color;  // error
@@ -85,9 +86,10 @@ enum class Status2 : std::uint32_t {
 };
 
 
+// 按从小到大的顺序返回x的质因子(含重复)，实现见concurrency/factorizer.h
 std::vector<std::size_t> primeFactors(std::size_t x) {
-    std::vector<std::size_t> res;
-    return res;
+    std::vector<uint64_t> factors = Factorize(x);
+    return std::vector<std::size_t>(factors.begin(), factors.end());
 };
 
 template<typename E>